@@ -0,0 +1,472 @@
+#include "archive.h"
+#include "pgn.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+using namespace std;
+
+// Number of games each worker claims at a time when replaying an archive.
+const uint64_t ARCHIVE_BATCH = 256;
+
+/**
+ * Destructor for archives. Unmaps and closes the file, if one is open.
+ */
+GameArchive::~GameArchive()
+{
+    if (_data)
+    {
+        munmap(const_cast<uint8_t *>(_data), _size);
+    }
+
+    if (_fd >= 0)
+    {
+        close(_fd);
+    }
+}
+
+/**
+ * Maps an archive into memory, and checks that its header and index fit inside the file.
+ * The games themselves are only checked as they're asked for.
+ *
+ * @param path Path of the file to open.
+ * @return Whether or not the file could be opened and looks like an archive.
+ */
+bool GameArchive::open(const string &path)
+{
+    struct stat info;
+
+    _fd = ::open(path.c_str(), O_RDONLY);
+    if (_fd < 0 || fstat(_fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(ArchiveHeader))
+    {
+        return false;
+    }
+
+    _size = info.st_size;
+    void *data = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if (data == MAP_FAILED)
+    {
+        _size = 0;
+        return false;
+    }
+
+    _data = static_cast<const uint8_t *>(data);
+
+    const ArchiveHeader *header = reinterpret_cast<const ArchiveHeader *>(_data);
+    if (memcmp(header->magic, "ACGA", 4) != 0 || header->version != ARCHIVE_VERSION ||
+        header->index_offset % 8 != 0 || header->index_offset > _size || header->games > (_size - header->index_offset) / 8 ||
+        header->players_offset % 8 != 0 || header->players_offset > _size || header->players > (_size - header->players_offset) / 8)
+    {
+        return false;
+    }
+
+    _index = reinterpret_cast<const uint64_t *>(_data + header->index_offset);
+    return true;
+}
+
+/**
+ * Returns the number of games in the archive.
+ * @return Number of games. 0 if no archive is open.
+ */
+uint64_t GameArchive::games() const
+{
+    return _index ? reinterpret_cast<const ArchiveHeader *>(_data)->games : 0;
+}
+
+/**
+ * Finds a game's record through the index.
+ * @param number Number of the game, counting from 0.
+ * @return The game's record, which its moves follow. NULL if there's no such game, or it runs off the end of the file.
+ */
+const GameRecord *GameArchive::game(uint64_t number) const
+{
+    if (number >= games())
+    {
+        return NULL;
+    }
+
+    uint64_t offset = _index[number];
+    if (offset % 4 != 0 || offset > _size || _size - offset < sizeof(GameRecord))
+    {
+        return NULL;
+    }
+
+    const GameRecord *record = reinterpret_cast<const GameRecord *>(_data + offset);
+    size_t move_size = record->encoding == ENCODING_INDEX ? 1 : 2;
+
+    if (_size - offset - sizeof(GameRecord) < record->plies * move_size)
+    {
+        return NULL;
+    }
+
+    return record;
+}
+
+/**
+ * Finds a player's name through the player table.
+ * @param id The player's id, from a game record.
+ * @return The player's name. "?" if there's no such player.
+ */
+const char *GameArchive::player(uint32_t id) const
+{
+    const ArchiveHeader *header = reinterpret_cast<const ArchiveHeader *>(_data);
+    if (!_index || id >= header->players)
+    {
+        return "?";
+    }
+
+    uint64_t offset = reinterpret_cast<const uint64_t *>(_data + header->players_offset)[id];
+    if (offset >= _size || !memchr(_data + offset, '\0', _size - offset))
+    {
+        return "?";
+    }
+
+    return reinterpret_cast<const char *>(_data + offset);
+}
+
+/**
+ * Works out one of a game's moves.
+ *
+ * Moves packed as squares can be read straight off, and were checked when the archive was written. Moves packed
+ * as indexes have to list the legal moves of the position to find out what they mean.
+ *
+ * @param record The game's record.
+ * @param ply Number of the move, counting from 0.
+ * @param board Board holding the position the move is played in. It isn't changed.
+ * @param scratch Buffer for listing legal moves in, kept by the caller so it doesn't have to be allocated every time.
+ * @param m Set to the move.
+ * @return Whether or not the move could be decoded.
+ */
+bool GameArchive::decode(const GameRecord *record, int ply, Board &board, vector<Move> &scratch, Move &m) const
+{
+    const uint8_t *moves = reinterpret_cast<const uint8_t *>(record + 1);
+
+    if (record->encoding == ENCODING_INDEX)
+    {
+        board.legal_moves(board.turn(), scratch);
+        if (moves[ply] >= scratch.size())
+        {
+            return false;
+        }
+
+        m = scratch[moves[ply]];
+        return true;
+    }
+
+    m = unpackMove(moves[2 * ply] | moves[2 * ply + 1] << 8);
+
+    // Applying a move doesn't check anything, so at least make sure the right player's piece is being moved.
+    const Square &from = board.square(m.from);
+    return from.occupied() && from.piece()->color() == board.turn();
+}
+
+/**
+ * Plays a game's moves out on a board.
+ *
+ * @param number Number of the game, counting from 0.
+ * @param board Board to play the moves on. It should hold the starting position.
+ * @param scratch Buffer for listing legal moves in, kept by the caller so it doesn't have to be allocated every time.
+ * @return Whether or not every move could be decoded.
+ */
+bool GameArchive::replay(uint64_t number, Board &board, vector<Move> &scratch) const
+{
+    const GameRecord *record = game(number);
+    if (!record)
+    {
+        return false;
+    }
+
+    for (int ply = 0; ply < record->plies; ply++)
+    {
+        Move m;
+        if (!decode(record, ply, board, scratch, m))
+        {
+            return false;
+        }
+
+        board.apply(m);
+    }
+
+    return true;
+}
+
+/**
+ * Reads a PGN date, like "2019.02.22", as a number, like 20190222. Unknown parts, written as "??", count as 0.
+ * @param date The date to read.
+ * @return The date as YYYYMMDD.
+ */
+static uint32_t packDate(const string &date)
+{
+    uint32_t parts[3] = {0, 0, 0};
+    int k = 0;
+
+    for (size_t i = 0; i < date.size() && k < 3; i++)
+    {
+        if (date[i] == '.')
+        {
+            k++;
+        }
+        else if (isdigit(date[i]))
+        {
+            parts[k] = parts[k] * 10 + (date[i] - '0');
+        }
+    }
+
+    return parts[0] * 10000 + parts[1] % 100 * 100 + parts[2] % 100;
+}
+
+/**
+ * Converts every game in a PGN file that replays cleanly from the usual starting position into an archive.
+ *
+ * The PGN file is replayed across a pool of threads the same way replayPgn() does it, with each worker packing
+ * the games in its own slices. The slices are then written out in order, so games keep their order from the file.
+ *
+ * @param pgn_path Path of the PGN file to read.
+ * @param archive_path Path of the archive to write.
+ * @param encoding How to pack the moves, from the ENCODING_ constants.
+ * @param threads Number of worker threads. If 0, one per core is used.
+ * @return 0 if the archive was written, 1 otherwise.
+ */
+int writeArchive(const string &pgn_path, const string &archive_path, uint8_t encoding, int threads)
+{
+    // A game that has been packed, but not given player ids yet.
+    struct Packed
+    {
+        GameRecord record;
+        string white;
+        string black;
+        string moves;
+    };
+
+    PgnFile file;
+    if (!file.open(pgn_path))
+    {
+        cout << "Couldn't open " << pgn_path << "." << endl;
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+
+    size_t slice = min<size_t>(1 << 20, max<size_t>(1 << 16, file.size() / (pool.size() * 16)));
+    size_t count = (file.size() + slice - 1) / slice; // Number of slices.
+    vector<vector<Packed>> packed(count);             // Games that replayed cleanly, by slice.
+    vector<long long> skipped(count, 0);              // Number of games left out of the archive, by slice.
+
+    pool.run(count, [&](size_t item, int) {
+        size_t end = min(file.size(), (item + 1) * slice);
+        PgnGame game;
+        vector<Move> moves;
+        vector<Move> legal;
+
+        for (size_t offset = file.next_game(item * slice); offset < end;)
+        {
+            size_t next = file.next_game(offset + 1);
+
+            moves.clear();
+            if (!replayGame(file.data() + offset, next - offset, game, &moves) || !game.fen.empty() || moves.size() > UINT16_MAX)
+            {
+                skipped[item]++;
+                offset = next;
+                continue;
+            }
+
+            Packed p;
+            p.record.result = game.result == "1-0" ? RESULT_WHITE : game.result == "0-1" ? RESULT_BLACK : game.result == "1/2-1/2" ? RESULT_DRAW : RESULT_UNKNOWN;
+            p.record.encoding = encoding;
+            p.record.plies = moves.size();
+            p.record.date = packDate(game.date);
+            p.white = game.white;
+            p.black = game.black;
+
+            Board board;
+            for (auto it = moves.begin(); it != moves.end(); ++it)
+            {
+                if (encoding == ENCODING_INDEX)
+                {
+                    board.legal_moves(board.turn(), legal);
+                    p.moves += static_cast<char>(find(legal.begin(), legal.end(), *it) - legal.begin());
+                    board.apply(*it);
+                }
+                else
+                {
+                    uint16_t packed_move = packMove(*it);
+                    p.moves += static_cast<char>(packed_move & 0xff);
+                    p.moves += static_cast<char>(packed_move >> 8);
+                }
+            }
+
+            packed[item].push_back(move(p));
+            offset = next;
+        }
+    });
+
+    ofstream out(archive_path, ios::binary | ios::trunc);
+    if (!out)
+    {
+        cout << "Couldn't create " << archive_path << "." << endl;
+        return 1;
+    }
+
+    // Players are numbered in the order they first appear.
+    unordered_map<string, uint32_t> ids;
+    vector<const string *> names;
+    auto id = [&](const string &name) {
+        auto found = ids.emplace(name, names.size());
+        if (found.second)
+        {
+            names.push_back(&found.first->first);
+        }
+        return found.first->second;
+    };
+
+    ArchiveHeader header = {{'A', 'C', 'G', 'A'}, ARCHIVE_VERSION, 0, 0, 0, 0, 0};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    vector<uint64_t> index;
+    uint64_t offset = sizeof(header);
+    uint64_t plies = 0;
+    long long total_skipped = 0;
+    const char padding[8] = {};
+
+    for (size_t item = 0; item < count; item++)
+    {
+        total_skipped += skipped[item];
+
+        for (auto it = packed[item].begin(); it != packed[item].end(); ++it)
+        {
+            it->record.white = id(it->white);
+            it->record.black = id(it->black);
+
+            index.push_back(offset);
+            out.write(reinterpret_cast<const char *>(&it->record), sizeof(GameRecord));
+            out.write(it->moves.data(), it->moves.size());
+            offset += sizeof(GameRecord) + it->moves.size();
+            plies += it->record.plies;
+
+            // Keep every record lined up on 4 bytes.
+            out.write(padding, -offset & 3);
+            offset += -offset & 3;
+        }
+    }
+
+    out.write(padding, -offset & 7);
+    offset += -offset & 7;
+    header.games = index.size();
+    header.index_offset = offset;
+    out.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(uint64_t));
+    offset += index.size() * sizeof(uint64_t);
+
+    // The player table, followed by every name it points to.
+    header.players_offset = offset;
+    header.players = names.size();
+    uint64_t name_offset = offset + names.size() * sizeof(uint64_t);
+    for (auto it = names.begin(); it != names.end(); ++it)
+    {
+        out.write(reinterpret_cast<const char *>(&name_offset), sizeof(name_offset));
+        name_offset += (*it)->size() + 1;
+    }
+
+    for (auto it = names.begin(); it != names.end(); ++it)
+    {
+        out.write((*it)->c_str(), (*it)->size() + 1);
+    }
+
+    long long size = out.tellp();
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.close();
+
+    if (!out)
+    {
+        cout << "Couldn't write " << archive_path << "." << endl;
+        return 1;
+    }
+
+    cout << "Archived " << header.games << " games (" << plies << " moves) from " << file.size() << " bytes of PGN into "
+         << size << " bytes. Left out " << total_skipped << " games that didn't replay cleanly from the usual starting position." << endl;
+
+    return 0;
+}
+
+/**
+ * Replays every game in an archive and prints a report on them.
+ * Workers claim games a batch at a time, and each keeps its own board, move buffer, and tally.
+ *
+ * @param path Path of the archive.
+ * @param threads Number of worker threads. If 0, one per core is used.
+ * @return 0 if every game replayed, 1 otherwise.
+ */
+int replayArchive(const string &path, int threads)
+{
+    // Counts kept by a single worker. Each is padded out to its own cache line, so workers don't slow each other down.
+    struct alignas(64) Tally
+    {
+        long long games;
+        long long plies;
+        long long failures;
+        long long results[4];
+    };
+
+    GameArchive archive;
+    if (!archive.open(path))
+    {
+        cout << "Couldn't open " << path << ", or it isn't an archive." << endl;
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    vector<Tally> tallies(pool.size(), Tally());
+    vector<vector<Move>> scratch(pool.size());
+    uint64_t games = archive.games();
+
+    auto start = chrono::steady_clock::now();
+
+    pool.run((games + ARCHIVE_BATCH - 1) / ARCHIVE_BATCH, [&](size_t item, int worker) {
+        Tally &tally = tallies[worker];
+
+        for (uint64_t number = item * ARCHIVE_BATCH; number < min(games, (item + 1) * ARCHIVE_BATCH); number++)
+        {
+            Board board;
+            const GameRecord *record = archive.game(number);
+
+            tally.games++;
+            if (!archive.replay(number, board, scratch[worker]))
+            {
+                tally.failures++;
+                continue;
+            }
+
+            tally.plies += record->plies;
+            tally.results[record->result & 3]++;
+        }
+    });
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    Tally total = Tally();
+    for (auto it = tallies.begin(); it != tallies.end(); ++it)
+    {
+        total.games += it->games;
+        total.plies += it->plies;
+        total.failures += it->failures;
+        for (int k = 0; k < 4; k++)
+        {
+            total.results[k] += it->results[k];
+        }
+    }
+
+    cout << "Replayed " << total.games << " games (" << total.plies << " moves) in " << seconds << " s with "
+         << pool.size() << " threads: " << static_cast<long long>(total.plies / max(seconds, 1e-9)) << " moves/s.\n"
+         << "Results: 1-0: " << total.results[RESULT_WHITE] << ", 0-1: " << total.results[RESULT_BLACK]
+         << ", 1/2-1/2: " << total.results[RESULT_DRAW] << ", other: " << total.results[RESULT_UNKNOWN] << ".\n"
+         << "Games that couldn't be decoded: " << total.failures << "." << endl;
+
+    return total.failures ? 1 : 0;
+}
@@ -0,0 +1,94 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "board.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+// How the moves of a game are packed into an archive.
+const uint8_t ENCODING_INDEX = 0;  // One byte per move: where the move comes in legal_moves() for the position it was played in.
+const uint8_t ENCODING_SQUARE = 1; // Two bytes per move: the square moved from in the low 6 bits, the square moved to in the next 6, and the promotion in the top 4.
+
+// Version of the archive format. Bumped whenever the layout changes, and whenever the order of legal_moves() changes,
+// since games packed with ENCODING_INDEX can't be unpacked with a different order.
+const uint32_t ARCHIVE_VERSION = 4;
+
+// Results of a game, as stored in an archive.
+const uint8_t RESULT_UNKNOWN = 0; // "*"
+const uint8_t RESULT_WHITE = 1;   // "1-0"
+const uint8_t RESULT_BLACK = 2;   // "0-1"
+const uint8_t RESULT_DRAW = 3;    // "1/2-1/2"
+
+// Start of every archive file.
+//
+// Every number in an archive is stored in the machine's own byte order, and every structure is padded out so
+// its fields line up, so the file can be used straight out of memory without decoding anything.
+struct ArchiveHeader
+{
+    char magic[4];           // Always "ACGA".
+    uint32_t version;        // Version of the format. Always ARCHIVE_VERSION.
+    uint64_t games;          // Number of games in the archive.
+    uint64_t index_offset;   // Byte offset of the index: one 8 byte offset per game, pointing at its GameRecord.
+    uint64_t players_offset; // Byte offset of the player table: one 8 byte offset per player, pointing at their name.
+    uint32_t players;        // Number of players in the player table.
+    uint32_t reserved;       // Always 0.
+};
+
+// Start of every game in an archive. The game's moves follow straight after it.
+struct GameRecord
+{
+    uint8_t result;   // How the game ended, from the RESULT_ constants above.
+    uint8_t encoding; // How the moves are packed, from the ENCODING_ constants above.
+    uint16_t plies;   // Number of moves.
+    uint32_t white;   // Player id of the white player.
+    uint32_t black;   // Player id of the black player.
+    uint32_t date;    // Date the game was played, as YYYYMMDD. Parts that aren't known are 0.
+};
+
+// Pieces a pawn can be promoted to, in the order they're numbered when packed. 0 means no promotion.
+const char PACKED_PROMOTIONS[] = " NBRQ";
+
+// Pack a move into two bytes: the square moved from in the low 6 bits, the square moved to in the next 6, and the
+// piece a pawn is promoted to in the top 4. Moves packed before promotion existed still unpack the same way.
+inline uint16_t packMove(Move m)
+{
+    int promotion = m.promotion ? strchr(PACKED_PROMOTIONS, m.promotion) - PACKED_PROMOTIONS : 0;
+    return (m.from.first * 8 + m.from.second) | (m.to.first * 8 + m.to.second) << 6 | promotion << 12;
+}
+
+// Unpack a move packed by packMove().
+inline Move unpackMove(uint16_t packed)
+{
+    int promotion = packed >> 12;
+    return {{(packed & 63) / 8, packed & 7}, {(packed >> 6 & 63) / 8, packed >> 6 & 7}, promotion > 0 && promotion < 5 ? PACKED_PROMOTIONS[promotion] : '\0'};
+}
+
+// An archive file mapped into memory. Any game can be found in constant time through the index.
+class GameArchive
+{
+private:
+    // Attributes.
+    int _fd;                // File descriptor of the open file. -1 if no file is open.
+    const uint8_t *_data;   // Contents of the file.
+    size_t _size;           // Size of the file in bytes.
+    const uint64_t *_index; // Offset of every game's record.
+
+public:
+    // Constructor and destructor.
+    GameArchive() : _fd(-1), _data(NULL), _size(0), _index(NULL) {} // Default constructor.
+    ~GameArchive();                                                  // Unmap and close the file.
+
+    bool open(const string &path);                                                                      // Map an archive into memory. Return false if it can't be opened or isn't an archive.
+    uint64_t games() const;                                                                             // Retrieve the number of games in the archive.
+    const GameRecord *game(uint64_t number) const;                                                      // Retrieve a game's record. Return NULL if it runs off the end of the file.
+    const char *player(uint32_t id) const;                                                              // Retrieve a player's name. Return "?" if there's no such player.
+    bool decode(const GameRecord *record, int ply, Board &board, vector<Move> &scratch, Move &m) const; // Work out one of a game's moves. Return false if it can't be decoded.
+    bool replay(uint64_t number, Board &board, vector<Move> &scratch) const;                            // Play a game's moves out on a board. Return false if a move can't be decoded.
+};
+
+int writeArchive(const string &pgn_path, const string &archive_path, uint8_t encoding, int threads); // Convert every clean game in a PGN file into an archive.
+int replayArchive(const string &path, int threads);                                                 // Replay every game in an archive across a pool of threads and report on them.
+
+#endif // ARCHIVE_H
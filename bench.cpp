@@ -0,0 +1,102 @@
+#include "bench.h"
+#include "search.h"
+#include <chrono>
+#include <iostream>
+using namespace std;
+
+// Positions searched by the benchmark: the start, some openings, some middlegames, and some endgames.
+// Changing this list changes the signature.
+static const char *const BENCH_POSITIONS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w - - 0 1",
+    "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w - - 2 3",
+    "rnbqkb1r/pp1p1ppp/4pn2/2pP4/2P5/8/PP2PPPP/RNBQKBNR w - - 0 4",
+    "r1bqk1nr/pppp1ppp/2n5/2b1p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w - - 4 4",
+    "r2q1rk1/pp2bppp/2n1pn2/3p4/3P4/2NBPN2/PP3PPP/R2QK2R w - - 0 10",
+    "r1b2rk1/2q1bppp/p2p1n2/np2p3/3PP3/5N1P/PPBN1PP1/R1BQR1K1 b - - 0 13",
+    "2r3k1/pp3ppp/4p3/3n4/3P4/P4N2/1P3PPP/2R3K1 w - - 0 25",
+    "8/5pk1/6p1/3R4/8/6P1/5PKP/3r4 b - - 0 40",
+    "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 50",
+    "6k1/5p2/6p1/8/7P/6P1/5PK1/3q4 b - - 0 45",
+};
+
+/**
+ * Searches every benchmark position to a fixed depth on a single thread, and reports how many positions were
+ * visited in total, how long it took, and how many positions were visited per second.
+ *
+ * Nothing about the search depends on the clock when the depth is fixed, so the node count is the same on every
+ * machine and every run. It works as a signature: if a change to the search or the rules changes it, the change
+ * altered which positions get searched, not just how fast.
+ *
+ * @param depth Depth to search every position to.
+ * @return 0 once the benchmark is done, 1 if the depth doesn't make sense.
+ */
+int runBench(int depth)
+{
+    if (depth <= 0 || depth > MAX_DEPTH)
+    {
+        cout << "Benchmark depth must be between 1 and " << MAX_DEPTH << "." << endl;
+        return 1;
+    }
+
+    Search search;
+    long long nodes = 0;
+    int count = sizeof(BENCH_POSITIONS) / sizeof(BENCH_POSITIONS[0]);
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < count; i++)
+    {
+        Board board(BENCH_POSITIONS[i]);
+        SearchResult result = search.run(board, board.turn(), {depth, 0, NULL});
+        nodes += result.nodes;
+
+        cout << "Position " << i + 1 << "/" << count << ": " << moveName(result.best) << ", " << result.nodes << " nodes" << endl;
+    }
+    long long elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+
+    cout << "===========================" << endl
+         << "Total time (ms) : " << elapsed << endl
+         << "Nodes searched  : " << nodes << endl
+         << "Nodes/second    : " << nodes * 1000 / max(elapsed, 1LL) << endl;
+
+    return 0;
+}
+
+/**
+ * Counts every position reachable from a position in exactly a number of moves, and prints the count below each
+ * first move as well as the total. The totals for well-known positions have been worked out by other engines, so
+ * a wrong one means the rules have a bug, and the per-move counts narrow down where it is.
+ *
+ * @param depth Number of moves to look ahead.
+ * @param fen The position to start from.
+ * @return 0 once the positions are counted, 1 if the depth or position doesn't make sense.
+ */
+int runPerft(int depth, const string &fen)
+{
+    Board board;
+    if (depth <= 0 || !board.set_fen(fen))
+    {
+        cout << "Perft needs a depth of at least 1 and a valid FEN string." << endl;
+        return 1;
+    }
+
+    long long nodes = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (const Move &m : board.legal_moves(board.turn()))
+    {
+        Board next(board);
+        next.apply(m);
+        long long count = next.perft(depth - 1);
+        nodes += count;
+
+        cout << moveName(m) << ": " << count << endl;
+    }
+    long long elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+
+    cout << "===========================" << endl
+         << "Total time (ms) : " << elapsed << endl
+         << "Nodes counted   : " << nodes << endl
+         << "Nodes/second    : " << nodes * 1000 / max(elapsed, 1LL) << endl;
+
+    return 0;
+}
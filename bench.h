@@ -0,0 +1,13 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <string>
+using namespace std;
+
+// Depth every benchmark position is searched to, unless another one is asked for.
+const int BENCH_DEPTH = 4;
+
+int runBench(int depth);                    // Search the built-in benchmark positions on one thread and report the node count, time, and speed.
+int runPerft(int depth, const string &fen); // Count the positions reachable in exactly depth moves, split up by first move.
+
+#endif // BENCH_H
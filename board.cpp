@@ -1,9 +1,16 @@
 #include "board.h"
+#include "history.h"
+#include "renderer.h"
+#include "stats.h"
+#include "trace.h"
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include <sstream>
 #include <iterator>
+#include <stdexcept>
 using namespace std;
 
 /**
@@ -11,66 +18,525 @@ using namespace std;
  * A chess board contains 8x8 squares.
  * Also initializes the pieces and the squares containing those pieces to their default values.
  */
-Board::Board() : _rows(8), _cols(8), _squares(8, vector<Square>(8, Square()))
+Board::Board() : _rows(8), _cols(8), _turn(WHITE), _halfmove_clock(0), _fullmove(1), _castling(ALL_CASTLING), _en_passant(-1), _mobility(-1)
 {
+    clear();
     init_pieces();
-    init_board();
 }
 
 /**
- * Default destructor for Chess Board class.
- * Due to the board containing two vectors of pointers to white and black pieces, we need to delete them in order to avoid memory leaks.
+ * Constructor for Chess Board class that sets up the position described by a FEN string,
+ * like "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w - - 0 1".
+ *
+ * @param fen The FEN string to read.
+ * @throws invalid_argument If the FEN string can't be read.
  */
-Board::~Board()
+Board::Board(const string &fen) : _rows(8), _cols(8), _turn(WHITE), _halfmove_clock(0), _fullmove(1), _castling(0), _en_passant(-1), _mobility(-1)
 {
-    // Travel through all white pieces and delete them all.
-    for (auto it = _white.begin(); it != _white.end(); ++it)
+    if (!set_fen(fen))
     {
-        delete *it;
+        throw invalid_argument("Invalid FEN: " + fen);
+    }
+}
+
+/**
+ * Initializes the chess pieces by putting the amount that exists for each type in a standard game of chess
+ * on their starting squares. The board should be empty.
+ */
+void Board::init_pieces()
+{
+    const char back_row[] = {ROOK, KNIGHT, BISHOP, QUEEN, KING, BISHOP, KNIGHT, ROOK};
+
+    for (int i = 0; i < _cols; i++)
+    {
+        add_piece(Piece(WHITE, back_row[i], {0, i}));
+        add_piece(Piece(BLACK, back_row[i], {7, i}));
     }
 
-    // Travel through all black pieces and delete them all.
-    for (auto it = _black.begin(); it != _black.end(); ++it)
+    for (int i = 0; i < _cols; i++)
     {
-        delete *it;
+        add_piece(Piece(WHITE, PAWN, {1, i}));
+        add_piece(Piece(BLACK, PAWN, {6, i}));
     }
 }
 
 /**
- * Initializes the chess pieces by creating the amount that exists for each type in a standard game of chess.
+ * Puts a new piece on the board, on the square it says it's on, and adds it to its player's pieces of its type.
+ * The square should be empty, and the player should have fewer than MAX_PIECES_OF_TYPE pieces of that type.
+ *
+ * @param piece The piece to add.
  */
-void Board::init_pieces()
+void Board::add_piece(const Piece &piece)
 {
-    int i = 0;
+    pair<int, int> location = piece.location();
+    int square = location.first * 8 + location.second;
+    int type = pieceType(piece.name());
+    PieceList &list = piece.color() == WHITE ? _white : _black;
+
+    _squares[location.first][location.second].set_piece(piece, location);
+    _index[square] = list.counts[type];
+    list.squares[type][list.counts[type]++] = square;
+}
+
+/**
+ * Takes the piece on a square off the board. The last piece of the same type and color takes its place in its
+ * player's list, so nothing has to be searched for or shifted along.
+ *
+ * @param square The square holding the piece. It must be occupied.
+ */
+void Board::remove_piece(Square *square)
+{
+    const Piece *piece = square->piece();
+    pair<int, int> location = piece->location();
+    int type = pieceType(piece->name());
+    PieceList &list = piece->color() == WHITE ? _white : _black;
+
+    unsigned char last = list.squares[type][--list.counts[type]];
+    list.squares[type][_index[location.first * 8 + location.second]] = last;
+    _index[last] = _index[location.first * 8 + location.second];
+    square->remove_piece();
+}
+
+/**
+ * Moves a piece to an empty square, and updates the square number its player keeps for it. The piece keeps its
+ * place among its player's pieces, so the order moves are listed in doesn't change.
+ *
+ * @param from Location of the piece to move.
+ * @param to Location to move it to.
+ */
+void Board::move_piece(pair<int, int> from, pair<int, int> to)
+{
+    Square &square = _squares[from.first][from.second];
+    PieceList &list = square.piece()->color() == WHITE ? _white : _black;
+    int index = _index[from.first * 8 + from.second];
+
+    list.squares[pieceType(square.piece()->name())][index] = to.first * 8 + to.second;
+    _index[to.first * 8 + to.second] = index;
+    _squares[to.first][to.second].set_piece(*square.piece(), to);
+    square.remove_piece();
+}
+
+/**
+ * Removes every piece from the board.
+ */
+void Board::clear()
+{
+    for (int type = 0; type < PIECE_TYPES; type++)
+    {
+        _white.counts[type] = 0;
+        _black.counts[type] = 0;
+    }
+
+    for (int r = 0; r < _rows; r++)
+    {
+        for (int c = 0; c < _cols; c++)
+        {
+            _squares[r][c] = Square();
+        }
+    }
+}
+
+/**
+ * Retrieves the square a pawn just skipped over by moving two squares, which an enemy pawn may capture onto.
+ *
+ * @return Location of the square, or {-1, -1} if there isn't one.
+ */
+pair<int, int> Board::en_passant() const
+{
+    return _en_passant < 0 ? make_pair(-1, -1) : make_pair(_en_passant / 8, _en_passant % 8);
+}
+
+/**
+ * Retrieves the pieces of one type a player has on the board.
+ *
+ * @param color Color of the player.
+ * @param name Name of the piece type.
+ * @return The pieces, in no particular order.
+ */
+PieceRange Board::pieces(char color, char name) const
+{
+    int type = pieceType(name);
+    return PieceRange(&_squares[0][0], color == WHITE ? _white : _black, type, type + 1);
+}
+
+/**
+ * Works out how many pieces of one type a player has lost from the pieces they still have. Nothing else needs to
+ * be kept track of: every piece missing from the set a player starts with was captured, except for the pawns that
+ * were promoted, which show up as extra pieces of the other types.
+ *
+ * @param color Color of the player.
+ * @param name Name of the piece type.
+ * @return Number of pieces of that type that have been captured.
+ */
+int Board::captured(char color, char name) const
+{
+    const PieceList &list = color == WHITE ? _white : _black;
+    int type = pieceType(name);
+
+    if (name != PAWN)
+    {
+        return max(0, PIECE_COUNTS[type] - list.counts[type]);
+    }
+
+    int promoted = 0;
+    for (int k = 0; k < PIECE_TYPES - 1; k++)
+    {
+        promoted += max(0, list.counts[k] - PIECE_COUNTS[k]);
+    }
+    return PIECE_COUNTS[type] - list.counts[type] - promoted;
+}
+
+/**
+ * Sets up the position described by a FEN string.
+ *
+ * The whole string is checked before anything on the board is touched, so a bad string leaves the board as it was.
+ * Castling rights for a king or rook that isn't on its starting square are dropped, and so is an en passant square
+ * no pawn could have just skipped over, since neither could ever be used.
+ * The halfmove and fullmove numbers may be left off, like they are in EPD files, but can't be over MAX_FEN_CLOCK.
+ *
+ * @param fen The FEN string to read.
+ * @return Whether or not the FEN string could be read.
+ */
+bool Board::set_fen(const string &fen)
+{
+    char names[8][8] = {};           // Piece on each square, using FEN letters. Uppercase is white, lowercase is black, 0 is empty.
+    int counts[2][PIECE_TYPES] = {}; // Number of each type of piece for white and black, in the order of PIECE_NAMES.
+    size_t i = 0;                    // Position of the next character in the FEN string to read.
+    size_t n = fen.size();           // Length of the FEN string.
+
+    // Piece placement, from the top row to the bottom row.
+    for (int r = 7; r >= 0; r--)
+    {
+        int c = 0;
+
+        while (i < n && fen[i] != '/' && fen[i] != ' ')
+        {
+            char letter = fen[i++];
+
+            if (letter >= '1' && letter <= '8')
+            {
+                c += letter - '0';
+            }
+            else
+            {
+                char name = toupper(letter);
+                if (c > 7 || (name != KING && name != QUEEN && name != ROOK && name != BISHOP && name != KNIGHT && name != PAWN))
+                {
+                    return false;
+                }
+
+                // Pawns can never be on the first or last row.
+                if (name == PAWN && (r == 0 || r == 7))
+                {
+                    return false;
+                }
+
+                counts[isupper(letter) ? 0 : 1][pieceType(name)]++;
+                names[r][c++] = letter;
+            }
+
+            if (c > 8)
+            {
+                return false;
+            }
+        }
+
+        if (c != 8 || (r > 0 && (i >= n || fen[i++] != '/')))
+        {
+            return false;
+        }
+    }
+
+    // Each player needs exactly one king, and every piece beyond the ones they start with must be a promoted pawn.
+    for (int color = 0; color < 2; color++)
+    {
+        int promoted = 0;
+        for (int k = 1; k < PIECE_TYPES - 1; k++)
+        {
+            promoted += max(0, counts[color][k] - PIECE_COUNTS[k]);
+        }
+
+        if (counts[color][0] != 1 || counts[color][PIECE_TYPES - 1] + promoted > PIECE_COUNTS[PIECE_TYPES - 1])
+        {
+            return false;
+        }
+    }
+
+    // The rest of the fields are separated by spaces. This finds the next one without copying it anywhere.
+    size_t start = i;
+    size_t end = i;
+    auto next_field = [&]() {
+        start = fen.find_first_not_of(' ', end);
+        start = start == string::npos ? n : start;
+        end = min(fen.find(' ', start), n);
+        return end - start;
+    };
+
+    // Color whose turn it is.
+    if (next_field() != 1 || (fen[start] != 'w' && fen[start] != 'b'))
+    {
+        return false;
+    }
+    char turn = fen[start] == 'w' ? WHITE : BLACK;
+
+    // Castling rights. Each one needs the king and that rook to still be on their starting squares.
+    if (!next_field() || fen.find_first_not_of("KQkq-", start) < end)
+    {
+        return false;
+    }
+
+    int castling = 0;
+    const char *rights = "KQkq";
+    const char corners[4][2] = {{'R', 7}, {'R', 0}, {'r', 7}, {'r', 0}}; // Rook and its column for each right, in the order of rights.
+    for (int k = 0; k < 4; k++)
+    {
+        int row = k < 2 ? 0 : 7;
+        if (fen.find(rights[k], start) < end && names[row][4] == (k < 2 ? 'K' : 'k') && names[row][int(corners[k][1])] == corners[k][0])
+        {
+            castling |= 1 << k;
+        }
+    }
+
+    // En passant square. It has to be behind a pawn of the player who just moved, which has just moved two squares.
+    size_t length = next_field();
+    if (!(length == 1 && fen[start] == '-') && !(length == 2 && checkMoveCoords(fen[start], fen[start + 1])))
+    {
+        return false;
+    }
+
+    int en_passant = -1;
+    if (length == 2)
+    {
+        int row = fen[start + 1] - '1';
+        int col = fen[start] - 'a';
+        int pawn_row = turn == WHITE ? 4 : 3;
+        char pawn = turn == WHITE ? 'p' : 'P';
+        if (row == (turn == WHITE ? 5 : 2) && !names[row][col] && names[pawn_row][col] == pawn)
+        {
+            en_passant = row * 8 + col;
+        }
+    }
+
+    // Halfmove clock and fullmove number, both of which are optional.
+    int clocks[2] = {0, 1};
+    for (int k = 0; k < 2 && next_field(); k++)
+    {
+        clocks[k] = 0;
+        for (size_t j = start; j < end; j++)
+        {
+            if (!isdigit(fen[j]))
+            {
+                return false;
+            }
+
+            clocks[k] = clocks[k] * 10 + (fen[j] - '0');
+            if (clocks[k] > MAX_FEN_CLOCK)
+            {
+                return false;
+            }
+        }
+    }
+
+    // The string makes sense, so it's finally safe to replace the current position.
+    clear();
+
+    for (int r = 0; r < _rows; r++)
+    {
+        for (int c = 0; c < _cols; c++)
+        {
+            if (!names[r][c])
+            {
+                continue;
+            }
+
+            char color = isupper(names[r][c]) ? WHITE : BLACK;
+            char name = toupper(names[r][c]);
+            add_piece(Piece(color, name, {r, c}));
+        }
+    }
+
+    _turn = turn;
+    _halfmove_clock = clocks[0];
+    _fullmove = max(1, clocks[1]);
+    _castling = castling;
+    _en_passant = en_passant;
+    _mobility = -1;
+
+    return true;
+}
+
+// Random numbers for hashing positions: one for every type of piece of either color on every square, one for
+// black to move, one for every combination of castling rights, and one for every column an en passant capture can
+// happen on. They come from a fixed seed, so hashes stay the same from one run to the next and can be saved to disk.
+static const struct ZobristKeys
+{
+    uint64_t pieces[2][6][64]; // Indexed by color (white first), piece type in the order of PIECE_NAMES, and square.
+    uint64_t black_to_move;
+    uint64_t castling[16];     // Indexed by the castling rights. Having none adds nothing.
+    uint64_t en_passant[8];    // Indexed by the column of the en passant square.
+
+    ZobristKeys()
+    {
+        uint64_t state = 0x9e3779b97f4a7c15; // Seed for splitmix64.
+        auto next = [&state]() {
+            uint64_t z = (state += 0x9e3779b97f4a7c15);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            return z ^ (z >> 31);
+        };
+
+        for (int color = 0; color < 2; color++)
+        {
+            for (int name = 0; name < 6; name++)
+            {
+                for (int square = 0; square < 64; square++)
+                {
+                    pieces[color][name][square] = next();
+                }
+            }
+        }
+
+        black_to_move = next();
+
+        castling[0] = 0;
+        for (int rights = 1; rights < 16; rights++)
+        {
+            castling[rights] = next();
+        }
+
+        for (int col = 0; col < 8; col++)
+        {
+            en_passant[col] = next();
+        }
+    }
+} ZOBRIST;
+
+/**
+ * Computes a Zobrist hash of the position: a random number for every piece on its square, one if it's black's turn,
+ * one for the castling rights, and one for the en passant square, all XORed together. The move counters aren't
+ * part of it, so the same position reached at different points in a game hashes the same.
+ *
+ * The en passant square only counts if a pawn is actually next to it, ready to capture. Otherwise every pawn
+ * moving two squares would make a position look different from the same position reached any other way.
+ *
+ * @return The hash of the position.
+ */
+uint64_t Board::hash() const
+{
+    uint64_t h = _turn == BLACK ? ZOBRIST.black_to_move : 0;
+    h ^= ZOBRIST.castling[_castling];
+
+    if (_en_passant >= 0)
+    {
+        int row = _turn == WHITE ? 4 : 3; // Row the capturing pawns would be on.
+        for (int side = -1; side <= 1; side += 2)
+        {
+            int col = _en_passant % 8 + side;
+            if (col < 0 || col > 7)
+            {
+                continue;
+            }
 
-    _white.push_back(new Rook(WHITE, {0, i}));      _black.push_back(new Rook(BLACK, {7, i++}));
-    _white.push_back(new Knight(WHITE, {0, i}));    _black.push_back(new Knight(BLACK, {7, i++}));
-    _white.push_back(new Bishop(WHITE, {0, i}));    _black.push_back(new Bishop(BLACK, {7, i++}));
-    _white.push_back(new Queen(WHITE, {0, i}));     _black.push_back(new Queen(BLACK, {7, i++}));
-    _white.push_back(new King(WHITE, {0, i}));      _black.push_back(new King(BLACK, {7, i++}));
-    _white.push_back(new Bishop(WHITE, {0, i}));    _black.push_back(new Bishop(BLACK, {7, i++}));
-    _white.push_back(new Knight(WHITE, {0, i}));    _black.push_back(new Knight(BLACK, {7, i++}));
-    _white.push_back(new Rook(WHITE, {0, i}));      _black.push_back(new Rook(BLACK, {7, i++}));
+            const Square &beside = _squares[row][col];
+            if (beside.occupied() && beside.piece()->name() == PAWN && beside.piece()->color() == _turn)
+            {
+                h ^= ZOBRIST.en_passant[_en_passant % 8];
+                break;
+            }
+        }
+    }
 
-    for (i = 0; i < _cols; i++)
+    for (int color = 0; color < 2; color++)
     {
-        _white.push_back(new Pawn(WHITE, {1, i}));
-        _black.push_back(new Pawn(BLACK, {6, i}));
+        PieceRange pieces = color == 0 ? white() : black();
+
+        for (auto it = pieces.begin(); it != pieces.end(); ++it)
+        {
+            pair<int, int> location = (*it)->location();
+            h ^= ZOBRIST.pieces[color][pieceType((*it)->name())][location.first * 8 + location.second];
+        }
     }
+
+    return h;
 }
 
-/** 
- * Initializes the board by placing the white and black pieces in their respective starting locations.
+/**
+ * Describes the current position as a FEN string. It's never longer than MAX_FEN_LENGTH characters.
+ *
+ * @return The FEN string for the current position.
  */
-void Board::init_board()
+string Board::to_fen() const
 {
-    for (int c = 0; c < _cols; c++)
+    char fen[MAX_FEN_LENGTH + 1];
+    int i = 0;
+
+    // Piece placement, from the top row to the bottom row.
+    for (int r = _rows - 1; r >= 0; r--)
+    {
+        int empty = 0;
+
+        for (int c = 0; c < _cols; c++)
+        {
+            if (!_squares[r][c].occupied())
+            {
+                empty++;
+                continue;
+            }
+
+            if (empty)
+            {
+                fen[i++] = '0' + empty;
+                empty = 0;
+            }
+
+            const Piece *piece = _squares[r][c].piece();
+            fen[i++] = piece->color() == WHITE ? piece->name() : tolower(piece->name());
+        }
+
+        if (empty)
+        {
+            fen[i++] = '0' + empty;
+        }
+
+        if (r > 0)
+        {
+            fen[i++] = '/';
+        }
+    }
+
+    fen[i++] = ' ';
+    fen[i++] = _turn == WHITE ? 'w' : 'b';
+    fen[i++] = ' ';
+
+    for (int k = 0; k < 4; k++)
+    {
+        if (_castling & 1 << k)
+        {
+            fen[i++] = "KQkq"[k];
+        }
+    }
+
+    if (!_castling)
+    {
+        fen[i++] = '-';
+    }
+
+    fen[i++] = ' ';
+    if (_en_passant >= 0)
+    {
+        fen[i++] = 'a' + _en_passant % 8;
+        fen[i++] = '1' + _en_passant / 8;
+    }
+    else
     {
-        _squares[0][c].set_piece(_white[c], {0, c});
-        _squares[1][c].set_piece(_white[c + _cols], {1, c});
-        _squares[7][c].set_piece(_black[c], {7, c});
-        _squares[6][c].set_piece(_black[c + _cols], {6, c});
+        fen[i++] = '-';
     }
+
+    // Clocks that have run past what set_fen() accepts are written at its limit, so the string can always be read back.
+    i += snprintf(fen + i, sizeof(fen) - i, " %d %d", min(_halfmove_clock, MAX_FEN_CLOCK), min(_fullmove, MAX_FEN_CLOCK));
+    i = min(i, static_cast<int>(sizeof(fen)) - 1);
+
+    return string(fen, i);
 }
 
 /**
@@ -110,7 +576,7 @@ void Board::print_board(ostream &out) const
     */
 
     // Print the top border.
-    out << "  _______________________________________" << endl;
+    out << "  _______________________________________\n";
 
     // Print everything but the bottom letter coords.
     for (int r = _rows - 1; r >= 0; r--)
@@ -141,7 +607,7 @@ void Board::print_board(ostream &out) const
 
         // Print the bottom portion of each square.
         out << "\n"
-            << " |____|____|____|____|____|____|____|____|" << endl;
+            << " |____|____|____|____|____|____|____|____|\n";
     }
 
     // Print the bottom letter coordinates.
@@ -155,7 +621,7 @@ void Board::print_board(ostream &out) const
 void Board::print_active(ostream &out) const
 {
     out << "\nWhite Active: " << endl;
-    for (auto it = _white.begin(); it != _white.end(); ++it)
+    for (auto it = white().begin(); it != white().end(); ++it)
     {
         out << (*it)->name() << " ";
     }
@@ -163,7 +629,7 @@ void Board::print_active(ostream &out) const
     out << "\n";
 
     out << "\nBlack Active: " << endl;
-    for (auto it = _black.begin(); it != _black.end(); ++it)
+    for (auto it = black().begin(); it != black().end(); ++it)
     {
         out << (*it)->name() << " ";
     }
@@ -178,17 +644,23 @@ void Board::print_active(ostream &out) const
 void Board::print_captured(ostream &out) const
 {
     out << "\nCaptured by White: " << endl;
-    for (auto it = _black_captured.begin(); it != _black_captured.end(); ++it)
+    for (int k = 0; k < PIECE_TYPES; k++)
     {
-        out << *it << " ";
+        for (int i = captured(BLACK, PIECE_NAMES[k]); i > 0; i--)
+        {
+            out << PIECE_NAMES[k] << " ";
+        }
     }
 
     out << "\n";
 
     out << "\nCaptured by Black: " << endl;
-    for (auto it = _white_captured.begin(); it != _white_captured.end(); ++it)
+    for (int k = 0; k < PIECE_TYPES; k++)
     {
-        out << *it << " ";
+        for (int i = captured(WHITE, PIECE_NAMES[k]); i > 0; i--)
+        {
+            out << PIECE_NAMES[k] << " ";
+        }
     }
 
     out << "\n";
@@ -196,28 +668,83 @@ void Board::print_captured(ostream &out) const
 
 /**
  * Play a game of chess between two human players locally.
+ *
+ * Commands are read one line at a time. Blank lines and anything after a # are ignored, and a move can be given
+ * either as two squares, like "e2 e4", or as one, like "e2e4". The game ends when a player quits, both players
+ * agree to a draw, someone is checkmated or stalemated, or the input runs out.
+ *
+ * @param in Where commands are read from.
+ * @param out Where the game's messages are written.
+ * @param interactive If true, the board is drawn before every command and every message waits for ENTER. If false,
+ *                    commands are played through as fast as they can be read, as when replaying a script.
  */
-void Board::play_human()
+void Board::play_human(istream &in, ostream &out, bool interactive)
 {
     string command;              // Entire line inputted by user as a command. Parsed for max of two potential separate strings later.
-    string turn_color = "White"; // Color whose turn it currently is.
-    string off_color = "Black";  // Color whose turn is next.
+    string turn_color = _turn == WHITE ? "White" : "Black"; // Color whose turn it currently is.
+    string off_color = _turn == WHITE ? "Black" : "White";  // Color whose turn is next.
     bool draw_agree = false;     // True if one player attempts to declare a draw.
+    Renderer renderer;           // Draws the board, only redrawing what's changed when the terminal allows it.
+    PositionHistory history;     // Every position the game has been in, for spotting a threefold repetition.
+
+    // Only a player at the keyboard needs to see the board or be given time to read a message.
+    auto draw = [&]() {
+        if (interactive)
+        {
+            renderer.draw(*this);
+        }
+    };
+    auto pause = [&]() {
+        if (interactive)
+        {
+            pressEnterToContinue();
+        }
+    };
 
     // Main game loop.
     //
-    // This will loop forever unless one player quits, both players draw, or one player is put in checkmate and loses.
+    // This will loop until one player quits, both players draw, one player is put in checkmate and loses, or
+    // there's nothing left to read.
     for (;;)
     {
-        print_board(cout);
+        draw();
+
+        if (interactive)
+        {
+            out << "\nIt is " << turn_color << "'s turn.\n"
+                << "Please input a command: ";
+        }
+
+        {
+            TraceScope trace("input");
+            if (!getline(in, command))
+            {
+                return;
+            }
+        }
 
-        cout << "\nIt is " << turn_color << "'s turn.\n"
-             << "Please input a command: ";
-        getline(cin, command);
+        // Everything after a # is a comment. Whitespace of any kind, including the \r of Windows line endings, separates words.
+        command.erase(min(command.find('#'), command.size()));
         transform(command.begin(), command.end(), command.begin(), ::tolower);
         istringstream iss(command);
         vector<string> commands{istream_iterator<string>{iss}, istream_iterator<string>{}};
 
+        if (commands.empty())
+        {
+            continue;
+        }
+
+        // A move written as one word, like "e2e4" or "e7e8q", is split into its two squares and its promotion.
+        Move single;
+        if (commands.size() == 1 && parseMove(commands[0], single))
+        {
+            commands = {commands[0].substr(0, 2), commands[0].substr(2, 2), commands[0].substr(4)};
+            if (commands[2].empty())
+            {
+                commands.pop_back();
+            }
+        }
+
         string first = commands[0];
 
         // Check if player whose turn it last was has attempted to declare a draw.
@@ -226,9 +753,9 @@ void Board::play_human()
             // Second player has agreed to a draw, and both players forfeit the game.
             if (first == "draw" || first == "stalemate" || first == "agree" || first == "yes" || first == "y")
             {
-                cout << "\nBoth sides have agreed to a draw.\n"
-                     << "Nobody wins." << endl;
-                pressEnterToContinue();
+                out << "\nBoth sides have agreed to a draw.\n"
+                    << "Nobody wins." << endl;
+                pause();
 
                 return;
             }
@@ -236,10 +763,10 @@ void Board::play_human()
             // Second player has disagreed to a draw, and the first player proceeds their turn as if nothing happened.
             else
             {
-                cout << "\n"
-                     << turn_color << " disagreed to a draw.\n"
-                     << off_color << " will proceed their turn as normal." << endl;
-                pressEnterToContinue();
+                out << "\n"
+                    << turn_color << " disagreed to a draw.\n"
+                    << off_color << " will proceed their turn as normal." << endl;
+                pause();
 
                 draw_agree = false;
                 string temp = turn_color;
@@ -253,10 +780,10 @@ void Board::play_human()
         // Exit chess program
         if (first == "exit" || first == "quit" || first == "surrender" || first == "forfeit")
         {
-            cout << "\n"
-                 << turn_color << " has given up.\n"
-                 << off_color << " wins!" << endl;
-            pressEnterToContinue();
+            out << "\n"
+                << turn_color << " has given up.\n"
+                << off_color << " wins!" << endl;
+            pause();
 
             return;
         }
@@ -264,37 +791,56 @@ void Board::play_human()
         // Print list of potential commands the user can input.
         else if (first == "?" || first == "help" || first == "instructions" || first == "guide" || first == "commands" || first == "info")
         {
-            cout << "\nCommands List:\n"
-                 << "  [letter][number] [letter][number]\n"
-                 << "    -  Moves a piece from the first location to the second location.\n"
-                 << "    -  Ex: If white has a pawn located at a2, they may input: a2 a4\n"
-                 << "  ? / help / instructions / guide / commands / info\n"
-                 << "    -  How'd you get here?\n"
-                 << "  exit / quit / surrender / forfeit\n"
-                 << "    -  Quit the game. Whoever's turn it is forfeits the match.\n"
-                 << "  active / alive\n"
-                 << "    -  Prints a list of the pieces that are still on the board for both white and black.\n"
-                 << "  captured / dead\n"
-                 << "    -  Prints a list of the pieces that have been captured by white and black.\n"
-                 << "  draw / stalemate\n"
-                 << "    -  Both players will need to enter this command on their turn in order to call a draw." << endl;
-            pressEnterToContinue();
+            out << "\nCommands List:\n"
+                << "  [letter][number] [letter][number]\n"
+                << "    -  Moves a piece from the first location to the second location.\n"
+                << "    -  Ex: If white has a pawn located at a2, they may input: a2 a4\n"
+                << "    -  The two locations may also be written together: a2a4\n"
+                << "    -  A pawn reaching the last row becomes a queen, unless a piece (q, r, b, or n) follows: e7 e8 n\n"
+                << "    -  To castle, move the king two squares toward the rook: e1 g1\n"
+                << "  ? / help / instructions / guide / commands / info\n"
+                << "    -  How'd you get here?\n"
+                << "  exit / quit / surrender / forfeit\n"
+                << "    -  Quit the game. Whoever's turn it is forfeits the match.\n"
+                << "  active / alive\n"
+                << "    -  Prints a list of the pieces that are still on the board for both white and black.\n"
+                << "  captured / dead\n"
+                << "    -  Prints a list of the pieces that have been captured by white and black.\n"
+                << "  draw / stalemate\n"
+                << "    -  Both players will need to enter this command on their turn in order to call a draw.\n"
+                << "  stats [reset]\n"
+                << "    -  Prints how often the move checking functions were called and how long they took, as JSON.\n"
+                << "    -  Only collected when the game is built with make stats. Add reset to start counting again." << endl;
+            pause();
+            continue;
+        }
+
+        // Print the hot path's call counts and timings as JSON. They're only collected in builds made with make stats.
+        else if (first == "stats")
+        {
+            out << "\n"
+                << statsJson() << endl;
+            if (commands.size() > 1 && commands[1] == "reset")
+            {
+                resetStats();
+            }
+            pause();
             continue;
         }
 
         // Print list of names of pieces currently on the board.
         else if (first == "active" || first == "alive")
         {
-            print_active(cout);
-            pressEnterToContinue();
+            print_active(out);
+            pause();
             continue;
         }
 
         // Print list of names of pieces that have been captured.
         else if (first == "captured" || first == "dead")
         {
-            print_captured(cout);
-            pressEnterToContinue();
+            print_captured(out);
+            pause();
             continue;
         }
 
@@ -303,44 +849,68 @@ void Board::play_human()
         {
             draw_agree = true;
 
-            cout << "\n"
-                 << turn_color << " has declared a draw.\n"
-                 << "If " << off_color << " also declares a draw, the game will end in a draw." << endl;
-            pressEnterToContinue();
+            out << "\n"
+                << turn_color << " has declared a draw.\n"
+                << "If " << off_color << " also declares a draw, the game will end in a draw." << endl;
+            pause();
         }
 
         // If the command is two sets of coordinates.
         else if (commands.size() > 1)
         {
-            string second = commands[1];
-            int move_result = move(toupper(turn_color[0]), first, second);
+            // Squares that can't be read are left off the board, and try_move() rejects them.
+            Move m = {{-1, -1}, {-1, -1}};
+            parseSquare(first, m.from);
+            parseSquare(commands[1], m.to);
+
+            // Anything but a single letter naming a piece is an invalid promotion, which try_move() rejects.
+            if (commands.size() > 2)
+            {
+                m.promotion = commands[2].size() == 1 ? toupper(commands[2][0]) : '?';
+            }
+
+            uint64_t before = hash();
+            MoveResult result = try_move(m);
+            int move_result = result.outcome;
 
             // The piece was not moved for some reason.
-            if (move_result == BAD)
+            if (result.error != MOVE_OK)
             {
+                out << "\n"
+                    << moveErrorMessage(result.error) << endl;
+                pause();
                 continue;
             }
 
-            // The enemy is in check and needs to secure their king.
-            else if (move_result == CHECK)
-            {
-                print_board(cout);
+            history.push(before);
 
-                cout << "\n"
-                     << off_color << " is in check.\n"
-                     << "Save your king!" << endl;
-                pressEnterToContinue();
+            // Let the players know a piece was captured. The capturing piece is now on the square that was moved to.
+            if (result.captured)
+            {
+                out << "\n"
+                    << square(m.to).piece()->fullName() << " captured " << off_color[0] << result.captured << endl;
+            }
+
+            // The enemy is in check and needs to secure their king.
+            if (move_result == CHECK)
+            {
+                draw();
+
+                out << "\n"
+                    << off_color << " is in check.\n"
+                    << "Save your king!" << endl;
+                pause();
             }
 
             // The enemy is in checkmate and has lost the game.
             else if (move_result == CHECKMATE)
             {
-                print_board(cout);
+                draw();
 
-                cout << "\n"
-                     << off_color << " is in checkmate.\n"
-                     << turn_color << " wins!" << endl;
-                pressEnterToContinue();
+                out << "\n"
+                    << off_color << " is in checkmate.\n"
+                    << turn_color << " wins!" << endl;
+                pause();
 
                 return;
             }
@@ -348,12 +918,38 @@ void Board::play_human()
             // The enemy is in stalemate and nobody wins the game.
             else if (move_result == STALEMATE)
             {
-                print_board(cout);
+                draw();
+
+                out << "\n"
+                    << off_color << " is in stalemate.\n"
+                    << "Nobody wins." << endl;
+                pause();
+
+                return;
+            }
+
+            // The same position has come up for the third time, with the same player to move and the same moves available.
+            if (history.repetitions(hash(), _halfmove_clock) >= 2)
+            {
+                draw();
+
+                out << "\n"
+                    << "The same position has been reached three times.\n"
+                    << "The game is a draw, and nobody wins." << endl;
+                pause();
+
+                return;
+            }
+
+            // Both players have gone fifty moves without capturing anything or moving a pawn.
+            if (_halfmove_clock >= FIFTY_MOVE_PLIES)
+            {
+                draw();
 
-                cout << "\n"
-                     << off_color << " is in stalemate.\n"
-                     << "Nobody wins." << endl;
-                pressEnterToContinue();
+                out << "\n"
+                    << "Fifty moves have been made without a capture or a pawn move.\n"
+                    << "The game is a draw, and nobody wins." << endl;
+                pause();
 
                 return;
             }
@@ -362,8 +958,8 @@ void Board::play_human()
         // Invalid command.
         else
         {
-            cout << "\nInvalid command. Please input [?] without the brackets if you need help." << endl;
-            pressEnterToContinue();
+            out << "\nInvalid command. Please input [?] without the brackets if you need help." << endl;
+            pause();
 
             continue;
         }
@@ -386,57 +982,82 @@ void Board::play_ai()
 }
 
 /**
- * Move a chess piece from one location to another.
- * @param color Either "B" or "W".
- * @param first Location on board that the piece is currently at. Example: "a5".
- * @param second Location on board that the piece is attempting to move to.
- * @return Movement outcome code defined in piece.h file.
+ * Attempt to move a chess piece from one location to another for the player whose turn it is.
+ *
+ * This only applies the rules. Nothing is printed and nothing waits on the player, so it's safe to call
+ * from anywhere. Explaining a rejected move is left to whoever called it (see moveErrorMessage()).
+ *
+ * @param m The move to make.
+ * @return Why the move was rejected, or the outcome code defined in piece.h if it was made.
  */
-int Board::move(char color, string first, string second)
+MoveResult Board::try_move(Move m)
 {
+    STAT_SCOPE(STAT_TRY_MOVE);
+    TraceScope trace("try_move");
+    MoveResult result = {MOVE_OK, BAD, 0};
+    char color = _turn;
+
     // Check that the coordinates given are within the boundaries of the 8x8 chess board.
-    if (!checkMoveCoords(first[0], first[1]) || !checkMoveCoords(second[0], second[1]))
+    if (!checkBounds(m.from) || !checkBounds(m.to))
     {
-        cout << "\nInvalid command. Please input [?] without the brackets if you need help." << endl;
-        pressEnterToContinue();
-        return BAD;
+        result.error = MOVE_OFF_BOARD;
+        return result;
     }
 
-    // Ascii math necessary to obtain the square at the [letter][number] coordinates given.
-    Square *move_from = &_squares[first[1] - 49][first[0] - 97];
+    Square *move_from = &_squares[m.from.first][m.from.second];
 
     // If the coordinates lead to a square that has no piece on it.
     if (!move_from->occupied())
     {
-        cout << "\nThere is no piece on that square." << endl;
-        pressEnterToContinue();
-        return BAD;
+        result.error = MOVE_NO_PIECE;
+        return result;
     }
 
     // If the coordinates lead to a square that has an enemy piece on it.
     if (move_from->piece()->color() != color)
     {
-        cout << "\nThat's not your piece." << endl;
-        pressEnterToContinue();
-        return BAD;
+        result.error = MOVE_NOT_YOUR_PIECE;
+        return result;
     }
 
     //
     // Anything past this assumes that the square given has one of the player's pieces on it.
     //
 
-    pair<int, int> move_from_loc = {first[1] - 49, first[0] - 97};
-    pair<int, int> move_to_loc = {second[1] - 49, second[0] - 97};
+    // Only a pawn reaching the last row can be promoted, and only to one of four pieces. If no piece is named, it
+    // becomes a queen.
+    bool promoting = move_from->piece()->name() == PAWN && (m.to.first == 0 || m.to.first == 7);
+    if (m.promotion && (!promoting || !strchr("QRBN", m.promotion)))
+    {
+        result.error = MOVE_PROMOTION;
+        return result;
+    }
+
+    // A king moving two squares sideways is castling, which has rules of its own.
+    if (move_from->piece()->name() == KING && m.from.first == m.to.first && abs(m.to.second - m.from.second) == 2)
+    {
+        if (!castling_allowed(m))
+        {
+            result.error = MOVE_CASTLING;
+            return result;
+        }
+
+        apply(m);
+        result.outcome = is_check(_squares[m.to.first][m.to.second].piece());
+        return result;
+    }
+
+    pair<int, int> move_to_loc = m.to;
     vector<pair<int, int>> move_to_list = move_from->piece()->moveCheck(move_to_loc);
+    STAT_CANDIDATES(move_to_list.size());
 
     // The last square in the list will be the square the player is attempting to move their piece to.
     // This checks to confirm that the player has made a valid choice based on the way in which that
     // particular piece can move according to the rules of chess.
     if (move_to_list.empty() || move_to_list.back() != move_to_loc)
     {
-        cout << "\nThat piece's movement doesn't allow it to reach that square." << endl;
-        pressEnterToContinue();
-        return BAD;
+        result.error = MOVE_UNREACHABLE;
+        return result;
     }
 
     // Checks the entire list of squares in the direction the piece is being moved to ensure that it
@@ -448,9 +1069,8 @@ int Board::move(char color, string first, string second)
     {
         if (_squares[(*it).first][(*it).second].occupied())
         {
-            cout << "\nThat piece is blocked from reaching that square." << endl;
-            pressEnterToContinue();
-            return BAD;
+            result.error = MOVE_BLOCKED;
+            return result;
         }
     }
 
@@ -465,24 +1085,21 @@ int Board::move(char color, string first, string second)
             // If the pawn is trying to move to a square occupied by a friendly piece.
             if (move_to->piece()->color() == color)
             {
-                cout << "\nThat piece is blocked from reaching that square." << endl;
-                pressEnterToContinue();
-                return BAD;
+                result.error = MOVE_BLOCKED;
+                return result;
             }
 
             // If the pawn is trying to capture an enemy piece in front of it.
             // A pawn can only capture enemy pieces one space diagonal in front of them.
-            cout << "\nA pawn can only capture another piece by moving forward diagonally one space." << endl;
-            pressEnterToContinue();
-            return BAD;
+            result.error = MOVE_PAWN_CAPTURE;
+            return result;
         }
 
         // If a piece is trying to capture a friendly piece.
         if (move_to->piece()->color() == color)
         {
-            cout << "\nYou cannot capture your own piece." << endl;
-            pressEnterToContinue();
-            return BAD;
+            result.error = MOVE_OWN_PIECE;
+            return result;
         }
         // If a piece is trying to capture an enemy piece.
         else
@@ -491,42 +1108,11 @@ int Board::move(char color, string first, string second)
             // the player's king on their next turn.
             if (is_suicide(move_from->piece(), move_to->piece(), move_to_loc))
             {
-                cout << "\nTrying to capture that piece would render your king vulnerable to capture." << endl;
-                pressEnterToContinue();
-                return BAD;
-            }
-
-            Piece &move_to_piece = *move_to->piece();
-
-            cout << "\n"
-                 << move_from->piece()->fullName() << " captured " << move_to->piece()->fullName() << endl;
-            move_to->remove_piece();
-
-            // If piece being captured is white.
-            if (move_to->piece()->color() == WHITE)
-            {
-                // Because we're removing the piece from the list of pieces we have a destructor for, we need
-                // to manually scrape it from the vector and delete it so Valgrind won't get mad.
-                // We also push its name to a list of the names of pieces that have been captured.
-                //
-                _white_captured.push_back(move_to->piece()->name());
-                auto to_remove = find(_white.begin(), _white.end(), move_to_piece);
-                delete *to_remove;
-                _white.erase(to_remove);
+                result.error = MOVE_SUICIDE_CAPTURE;
+                return result;
             }
 
-            // If piece being captured is black.
-            else
-            {
-                // Because we're removing the piece from the list of pieces we have a destructor for, we need
-                // to manually scrape it from the vector and delete it so Valgrind won't get mad.
-                // We also push its name to a list of the names of pieces that have been captured.
-                //
-                _black_captured.push_back(move_to->piece()->name());
-                auto to_remove = find(_black.begin(), _black.end(), move_to_piece);
-                delete *to_remove;
-                _black.erase(to_remove);
-            }
+            result.captured = move_to->piece()->name();
         }
     }
 
@@ -534,29 +1120,157 @@ int Board::move(char color, string first, string second)
     else
     {
         // If a pawn is being moved to an empty square, it has to be in front of it.
-        // A pawn can only be moved diagonally one space if the space is occupied by an enemy piece.
+        // A pawn can only be moved diagonally one space if the space is occupied by an enemy piece,
+        // or if it's capturing a pawn that just moved two squares past it, en passant.
         if (move_from->piece()->name() == PAWN && move_from->piece()->location().second != move_to_loc.second)
         {
-            cout << "\nA pawn can only capture another piece by moving forward diagonally one space." << endl;
-            pressEnterToContinue();
-            return BAD;
+            if (move_to_loc != en_passant())
+            {
+                result.error = MOVE_PAWN_CAPTURE;
+                return result;
+            }
+
+            if (!en_passant_allowed(m))
+            {
+                result.error = MOVE_SUICIDE_CAPTURE;
+                return result;
+            }
+
+            apply(m);
+            result.captured = PAWN;
+            result.outcome = is_check(move_to->piece());
+            return result;
         }
 
         // This is an invalid move, because moving here would allow the enemy to capture
         // the player's king on their next turn.
         if (is_suicide(move_from->piece(), move_to->piece(), move_to_loc))
         {
-            cout << "\nMoving that piece there would render your king vulnerable to capture." << endl;
-            pressEnterToContinue();
-            return BAD;
+            result.error = MOVE_SUICIDE;
+            return result;
         }
     }
 
-    // Set the new square to contain this piece.
-    move_to->set_piece(move_from->piece(), move_to_loc);
-    move_from->remove_piece();
+    // Set the new square to contain this piece, capturing whatever was there, and pass the turn.
+    apply(m);
 
-    return is_check(move_to->piece());
+    result.outcome = is_check(move_to->piece());
+    return result;
+}
+
+/**
+ * Replaces the pawn on a square with a new piece of another type, for the same player.
+ *
+ * @param square Square holding the pawn.
+ * @param name Name of the piece the pawn becomes.
+ */
+void Board::promote(Square *square, char name)
+{
+    const Piece *pawn = square->piece();
+    Piece promoted(pawn->color(), name, pawn->location());
+
+    remove_piece(square);
+    add_piece(promoted);
+}
+
+/**
+ * Checks if a king moving two squares sideways is a legal castle: the player still has the right to castle on that
+ * side, every square between the king and the rook is empty, and the king isn't in check, doesn't pass through an
+ * attacked square, and doesn't land on one.
+ *
+ * @param m The king's move.
+ * @return Whether or not the castle is legal.
+ */
+bool Board::castling_allowed(Move m)
+{
+    const Piece *king = _squares[m.from.first][m.from.second].piece();
+    char color = king->color();
+    bool kingside = m.to.second > m.from.second;
+    int right = color == WHITE ? (kingside ? WHITE_KINGSIDE : WHITE_QUEENSIDE) : (kingside ? BLACK_KINGSIDE : BLACK_QUEENSIDE);
+    int row = color == WHITE ? 0 : 7;
+
+    // Having the right means the king and the rook are both still on their starting squares.
+    if (!(_castling & right) || m.from != make_pair(row, 4))
+    {
+        return false;
+    }
+
+    for (int c = kingside ? 5 : 1; c < (kingside ? 7 : 4); c++)
+    {
+        if (_squares[row][c].occupied())
+        {
+            return false;
+        }
+    }
+
+    if (in_check(color))
+    {
+        return false;
+    }
+
+    int step = kingside ? 1 : -1;
+    return !is_suicide(king, NULL, {row, 4 + step}) && !is_suicide(king, NULL, {row, 4 + 2 * step});
+}
+
+/**
+ * Checks if a pawn capturing en passant leaves its own king safe. Two pawns leave the row at once, which can
+ * uncover an attack that looking at the capturing pawn alone would miss, so the capture is simply tried on a copy
+ * of the board. En passant is rare enough that this costs next to nothing overall.
+ *
+ * @param m The pawn's move onto the en passant square.
+ * @return Whether or not the capture is legal.
+ */
+bool Board::en_passant_allowed(Move m)
+{
+    char color = _squares[m.from.first][m.from.second].piece()->color();
+    Board next(*this);
+    next.apply(m);
+    return !next.in_check(color);
+}
+
+/**
+ * Adds every legal castle and en passant capture for a player to a list of moves. Neither fits the way the pieces
+ * list the squares they can reach, so they're looked for separately.
+ *
+ * @param color Color of the player.
+ * @param moves The list to add them to.
+ */
+void Board::special_moves(char color, vector<Move> &moves)
+{
+    pair<int, int> target = en_passant();
+    if (target.first >= 0 && color == _turn)
+    {
+        int row = target.first + (color == WHITE ? -1 : 1); // Row the capturing pawns would be on.
+        for (int side = -1; side <= 1; side += 2)
+        {
+            int col = target.second + side;
+            if (col < 0 || col > 7 || !_squares[row][col].occupied())
+            {
+                continue;
+            }
+
+            const Piece *piece = _squares[row][col].piece();
+            Move m = {{row, col}, target};
+            if (piece->name() == PAWN && piece->color() == color && en_passant_allowed(m))
+            {
+                moves.push_back(m);
+            }
+        }
+    }
+
+    int row = color == WHITE ? 0 : 7;
+    int rights = color == WHITE ? WHITE_KINGSIDE | WHITE_QUEENSIDE : BLACK_KINGSIDE | BLACK_QUEENSIDE;
+    if (_castling & rights)
+    {
+        for (int col = 2; col <= 6; col += 4)
+        {
+            Move m = {{row, 4}, {row, col}};
+            if (castling_allowed(m))
+            {
+                moves.push_back(m);
+            }
+        }
+    }
 }
 
 /**
@@ -566,13 +1280,15 @@ int Board::move(char color, string first, string second)
  * @param move_to_loc Coordinates of square being moved to.
  * @return Whether or not the king is vulnerable.
  */
-bool Board::is_suicide(Piece *move_from_piece, Piece *move_to_piece, pair<int, int> move_to_loc)
+bool Board::is_suicide(const Piece *move_from_piece, const Piece *move_to_piece, pair<int, int> move_to_loc)
 {
+    STAT_SCOPE(STAT_IS_SUICIDE);
+
     // Piece being moved is white.
     if (move_from_piece->color() == WHITE)
     {
         // Iterate through every black piece on the board.
-        for (auto it = _black.begin(); it != _black.end(); ++it)
+        for (auto it = black().begin(); it != black().end(); ++it)
         {
             // If move_to_piece isn't NULL.
             //
@@ -593,6 +1309,7 @@ bool Board::is_suicide(Piece *move_from_piece, Piece *move_to_piece, pair<int, i
             {
                 for (auto itb = (*ita).begin(); itb != (*ita).end(); ++itb)
                 {
+                    STAT_CANDIDATES(1);
                     pair<int, int> location = {(*itb).first, (*itb).second};      // Coordinates of the square being moved to.
                     Square *move_to = &_squares[location.first][location.second]; // Square being moved to.
 
@@ -654,7 +1371,7 @@ bool Board::is_suicide(Piece *move_from_piece, Piece *move_to_piece, pair<int, i
     else
     {
         // Iterate through every white piece on the board.
-        for (auto it = _white.begin(); it != _white.end(); ++it)
+        for (auto it = white().begin(); it != white().end(); ++it)
         {
             // If move_to_piece isn't NULL.
             //
@@ -675,6 +1392,7 @@ bool Board::is_suicide(Piece *move_from_piece, Piece *move_to_piece, pair<int, i
             {
                 for (auto itb = (*ita).begin(); itb != (*ita).end(); ++itb)
                 {
+                    STAT_CANDIDATES(1);
                     pair<int, int> location = {(*itb).first, (*itb).second};      // Coordinates of the square being moved to.
                     Square *move_to = &_squares[location.first][location.second]; // Square being moved to.
 
@@ -734,122 +1452,48 @@ bool Board::is_suicide(Piece *move_from_piece, Piece *move_to_piece, pair<int, i
 }
 
 /**
- * Check if the color passed in is in checkmate by running through every single possible move that its
- * available pieces can make to see if even a single one will ensure that their king cannot be captured
- * by the enemy next turn.
- * 
+ * Check if the color passed in is in checkmate, meaning their opponent has no move that leaves their own king safe.
+ * Whether the player to move can move at all is only worked out once per position, so checking again, or checking
+ * for a stalemate after checking for a checkmate, is a single lookup.
+ *
  * @param color Color of the player we're checking for checkmate.
  * @return Whether or not the player is in checkmate.
  */
 bool Board::is_checkmate(char color)
 {
-    // Piece potentially in checkmate is white.
-    if (color == BLACK)
-    {
-        // Iterate through every white piece on the board.
-        for (auto it = _white.begin(); it != _white.end(); ++it)
-        {
-            vector<vector<pair<int, int>>> all_move_to_list = (*it)->allMoveCheck(); // A list of the potential squares a piece can move to.
-
-            // Iterate through the coordinates of every potential square this piece can move to.
-            for (auto ita = all_move_to_list.begin(); ita != all_move_to_list.end(); ++ita)
-            {
-                for (auto itb = (*ita).begin(); itb != (*ita).end(); ++itb)
-                {
-                    pair<int, int> location = {(*itb).first, (*itb).second};      // Location of square being moved to.
-                    Square *move_to = &_squares[location.first][location.second]; // Square being moved to.
-
-                    // If piece hits a square with another piece in it.
-                    if (move_to->occupied())
-                    {
-                        // If piece hits a friendly piece, it can't move to that square or beyond it.
-                        // Also checks if piece is a pawn and attempting to capture an enemy piece in front of it.
-                        if (move_to->piece()->color() == WHITE || ((*it)->name() == PAWN && (*it)->location().second == location.second))
-                        {
-                            break;
-                        }
-
-                        // If piece hits an enemy piece, check for checkmate based on new piece's location, and the fact that particular
-                        // enemy piece will be captured.
-                        if (!is_suicide(*it, move_to->piece(), location))
-                        {
-                            return false;
-                        }
-                    }
-
-                    // If piece hits an empty square.
-                    else
-                    {
-                        // If piece is a pawn and attempting to move diagonally without capturing an enemy piece.
-                        if ((*it)->name() == PAWN && (*it)->location().second != location.second)
-                        {
-                            break;
-                        }
-
-                        // Check for checkmate based on new piece's location.
-                        if (!is_suicide(*it, NULL, location))
-                        {
-                            return false;
-                        }
-                    }
-                }
-            }
-        }
-    }
+    char player = opponent(color); // Player who has to find a move.
+    return player == _turn ? !has_legal_move() : !find_legal_move(player);
+}
 
-    // Piece potentially in checkmate is black.
-    else
+/**
+ * Checks if the player to move has any legal move. The answer is kept until the next move is made, and listing
+ * the player's legal moves fills it in too, so it's only ever worked out once per position.
+ *
+ * @return Whether or not the player to move has any legal move.
+ */
+bool Board::has_legal_move()
+{
+    if (_mobility < 0)
     {
-        // Iterate through every black piece on the board.
-        for (auto it = _black.begin(); it != _black.end(); ++it)
-        {
-            vector<vector<pair<int, int>>> all_move_to_list = (*it)->allMoveCheck(); // A list of the potential squares a piece can move to.
-
-            // Iterate through the coordinates of every potential square this piece can move to.
-            for (auto ita = all_move_to_list.begin(); ita != all_move_to_list.end(); ++ita)
-            {
-                for (auto itb = (*ita).begin(); itb != (*ita).end(); ++itb)
-                {
-                    pair<int, int> location = {(*itb).first, (*itb).second};      // Location of square being moved to.
-                    Square *move_to = &_squares[location.first][location.second]; // Square being moved to.
-
-                    // If piece hits a square with another piece in it.
-                    if (move_to->occupied())
-                    {
-                        // If piece hits a friendly piece, it can't move to that square or beyond it.
-                        // Also checks if piece is a pawn and attempting to capture an enemy piece in front of it.
-                        if (move_to->piece()->color() == BLACK || ((*it)->name() == PAWN && (*it)->location().second == location.second))
-                        {
-                            break;
-                        }
+        _mobility = find_legal_move(_turn);
+    }
 
-                        // If piece hits an enemy piece, check for checkmate based on new piece's location, and the fact that particular
-                        // enemy piece will be captured.
-                        if (!is_suicide(*it, move_to->piece(), location))
-                        {
-                            return false;
-                        }
-                    }
-                    else
-                    {
-                        // If piece is a pawn and attempting to move diagonally without capturing an enemy piece.
-                        if ((*it)->name() == PAWN && (*it)->location().second != location.second)
-                        {
-                            break;
-                        }
+    return _mobility;
+}
 
-                        // Check for checkmate based on new piece's location.
-                        if (!is_suicide(*it, NULL, location))
-                        {
-                            return false;
-                        }
-                    }
-                }
-            }
-        }
-    }
+/**
+ * Runs through the moves a player's available pieces can make, until it finds one that will ensure that their king
+ * cannot be captured by the enemy next turn. The moves are worked out one at a time, so none past that one are.
+ *
+ * @param color Color of the player whose moves are checked.
+ * @return Whether or not the player has any legal move.
+ */
+bool Board::find_legal_move(char color)
+{
+    STAT_SCOPE(STAT_IS_CHECKMATE);
 
-    return true;
+    MoveGenerator moves = generate_moves(color, false);
+    return moves.begin() != moves.end();
 }
 
 /**
@@ -858,8 +1502,10 @@ bool Board::is_checkmate(char color)
  * @param move_from_piece Piece being moved.
  * @return int 0 if good, 1 if check, 2 if checkmate, and 3 if stalemate.
  */
-int Board::is_check(Piece *move_from_piece)
+int Board::is_check(const Piece *move_from_piece)
 {
+    STAT_SCOPE(STAT_IS_CHECK);
+
     vector<vector<pair<int, int>>> check_list = move_from_piece->allMoveCheck();
 
     // If piece that was moved was white.
@@ -869,6 +1515,7 @@ int Board::is_check(Piece *move_from_piece)
         {
             for (auto ita = (*it).begin(); ita != (*it).end(); ++ita)
             {
+                STAT_CANDIDATES(1);
                 pair<int, int> location = {(*ita).first, (*ita).second};
                 Square *move_to_square = &_squares[location.first][location.second];
 
@@ -902,6 +1549,7 @@ int Board::is_check(Piece *move_from_piece)
         {
             for (auto ita = (*it).begin(); ita != (*it).end(); ++ita)
             {
+                STAT_CANDIDATES(1);
                 pair<int, int> location = {(*ita).first, (*ita).second};
                 Square *move_to_square = &_squares[location.first][location.second];
 
@@ -928,6 +1576,12 @@ int Board::is_check(Piece *move_from_piece)
         }
     }
 
+    // The piece that was moved may have uncovered an attack on the enemy king by another piece behind it.
+    if (in_check(opponent(move_from_piece->color())))
+    {
+        return is_checkmate(move_from_piece->color()) ? CHECKMATE : CHECK;
+    }
+
     // If the enemy player isn't in check, but cannot make any valid moves, they are in stalemate,
     // and the game ends in a draw.
     if (is_checkmate(move_from_piece->color()))
@@ -939,6 +1593,425 @@ int Board::is_check(Piece *move_from_piece)
     return GOOD;
 }
 
+/**
+ * Checks if the king of the given color could be captured by the enemy right now.
+ *
+ * Unlike is_check(), this doesn't only look at the piece that was just moved, so it also catches
+ * a king that has been exposed by a friendly piece stepping out of the way.
+ *
+ * @param color Color of the king we're checking.
+ * @return Whether or not the king is vulnerable.
+ */
+bool Board::in_check(char color)
+{
+    PieceRange enemies = color == WHITE ? black() : white(); // Every piece that could capture the king.
+
+    for (auto it = enemies.begin(); it != enemies.end(); ++it)
+    {
+        vector<vector<pair<int, int>>> all_move_to_list = (*it)->allMoveCheck(); // All possible squares the piece can move to.
+
+        for (auto ita = all_move_to_list.begin(); ita != all_move_to_list.end(); ++ita)
+        {
+            for (auto itb = (*ita).begin(); itb != (*ita).end(); ++itb)
+            {
+                Square *move_to = &_squares[(*itb).first][(*itb).second]; // Square being moved to.
+
+                // Pieces can't move through other pieces, so only the first occupied square in each direction matters.
+                if (move_to->occupied())
+                {
+                    // A pawn can't capture the piece directly in front of it.
+                    if ((*it)->name() == PAWN && (*it)->location().second == (*itb).second)
+                    {
+                        break;
+                    }
+
+                    if (move_to->piece()->color() == color && move_to->piece()->name() == KING)
+                    {
+                        return true;
+                    }
+
+                    break;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Lists every move the given color can make without rendering its own king vulnerable.
+ * Follows the same logic as is_checkmate(), but keeps going after the first valid move is found.
+ *
+ * @param color Color of the player whose moves we want.
+ * @return Every legal move for that player. Empty if they're in checkmate or stalemate.
+ */
+vector<Move> Board::legal_moves(char color)
+{
+    vector<Move> moves;
+    legal_moves(color, moves);
+    return moves;
+}
+
+/**
+ * Lists every move a player can make without rendering their king vulnerable, into a buffer the caller keeps
+ * around. The buffer is emptied first, but keeps its memory, so filling it again doesn't allocate.
+ *
+ * @param color Color of the player whose moves are listed.
+ * @param moves Buffer to fill with the moves.
+ */
+void Board::legal_moves(char color, vector<Move> &moves)
+{
+    moves.clear();
+    PieceRange pieces = color == WHITE ? white() : black(); // Every piece the player can move.
+
+    for (auto it = pieces.begin(); it != pieces.end(); ++it)
+    {
+        vector<vector<pair<int, int>>> all_move_to_list = (*it)->allMoveCheck(); // A list of the potential squares a piece can move to.
+
+        for (auto ita = all_move_to_list.begin(); ita != all_move_to_list.end(); ++ita)
+        {
+            for (auto itb = (*ita).begin(); itb != (*ita).end(); ++itb)
+            {
+                pair<int, int> location = {(*itb).first, (*itb).second};      // Location of square being moved to.
+                Square *move_to = &_squares[location.first][location.second]; // Square being moved to.
+
+                // If piece hits a square with another piece in it.
+                if (move_to->occupied())
+                {
+                    // A piece can't capture a friendly piece, and a pawn can't capture the piece in front of it.
+                    if (move_to->piece()->color() != color && !((*it)->name() == PAWN && (*it)->location().second == location.second))
+                    {
+                        if (!is_suicide(*it, move_to->piece(), location))
+                        {
+                            add_move(*it, location, moves);
+                        }
+                    }
+
+                    // Either way, the piece can't move beyond this square.
+                    break;
+                }
+
+                // If piece is a pawn and attempting to move diagonally without capturing an enemy piece.
+                if ((*it)->name() == PAWN && (*it)->location().second != location.second)
+                {
+                    break;
+                }
+
+                if (!is_suicide(*it, NULL, location))
+                {
+                    add_move(*it, location, moves);
+                }
+            }
+        }
+    }
+
+    special_moves(color, moves);
+
+    if (color == _turn)
+    {
+        _mobility = !moves.empty();
+    }
+}
+
+/**
+ * Works out every move a player can make without rendering their king vulnerable, one at a time. A caller that
+ * finds what it needs among the first few moves can stop there, and the rest are never worked out.
+ *
+ * Staged, the moves come in two stages: every capture first, en passant included, and then every quiet move,
+ * castling included. That's the order a search wants to try them in, but it means looking at every piece's moves
+ * twice. Otherwise they come in the same order as legal_moves(), in a single pass.
+ *
+ * The board must be left alone while the moves are being looked at.
+ *
+ * @param color Color of the player whose moves we want.
+ * @param staged Whether or not every capture should come before any quiet move.
+ * @return A generator yielding the same moves as legal_moves().
+ */
+MoveGenerator Board::generate_moves(char color, bool staged)
+{
+    PieceRange pieces = color == WHITE ? white() : black(); // Every piece the player can move.
+
+    for (int stage = 0; stage < (staged ? 2 : 1); stage++)
+    {
+        bool captures = !staged || stage == 0; // Whether this stage looks for captures.
+        bool quiets = !staged || stage == 1;   // Whether this stage looks for quiet moves.
+
+        for (auto it = pieces.begin(); it != pieces.end(); ++it)
+        {
+            vector<vector<pair<int, int>>> all_move_to_list = (*it)->allMoveCheck(); // A list of the potential squares a piece can move to.
+            bool pawn = (*it)->name() == PAWN;
+
+            for (auto ita = all_move_to_list.begin(); ita != all_move_to_list.end(); ++ita)
+            {
+                for (auto itb = (*ita).begin(); itb != (*ita).end(); ++itb)
+                {
+                    pair<int, int> location = {(*itb).first, (*itb).second};      // Location of square being moved to.
+                    Square *move_to = &_squares[location.first][location.second]; // Square being moved to.
+                    bool forward = (*it)->location().second == location.second;   // Whether a pawn would be moving straight ahead.
+
+                    // The first occupied square along each line is the only one that can be captured, and nothing
+                    // beyond it can be reached. A pawn can't capture the piece in front of it, and can only move
+                    // diagonally by capturing.
+                    bool capture = move_to->occupied();
+                    if (capture ? move_to->piece()->color() == color || (pawn && forward) : pawn && !forward)
+                    {
+                        break;
+                    }
+
+                    if ((capture ? captures : quiets) && !is_suicide(*it, capture ? move_to->piece() : NULL, location))
+                    {
+                        if (pawn && (location.first == 0 || location.first == 7))
+                        {
+                            for (char promotion : {QUEEN, ROOK, BISHOP, KNIGHT})
+                            {
+                                co_yield Move{(*it)->location(), location, promotion};
+                            }
+                        }
+                        else
+                        {
+                            co_yield Move{(*it)->location(), location};
+                        }
+                    }
+
+                    if (capture)
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+
+        // Castling and en passant aren't in the lists above, so they come at the end of their stage.
+        if (captures)
+        {
+            pair<int, int> target = en_passant();
+            if (target.first >= 0 && color == _turn)
+            {
+                int row = target.first + (color == WHITE ? -1 : 1); // Row the capturing pawns would be on.
+                for (int side = -1; side <= 1; side += 2)
+                {
+                    int col = target.second + side;
+                    if (col < 0 || col > 7 || !_squares[row][col].occupied())
+                    {
+                        continue;
+                    }
+
+                    const Piece *piece = _squares[row][col].piece();
+                    Move m = {{row, col}, target};
+                    if (piece->name() == PAWN && piece->color() == color && en_passant_allowed(m))
+                    {
+                        co_yield m;
+                    }
+                }
+            }
+        }
+
+        if (quiets)
+        {
+            int row = color == WHITE ? 0 : 7;
+            int rights = color == WHITE ? WHITE_KINGSIDE | WHITE_QUEENSIDE : BLACK_KINGSIDE | BLACK_QUEENSIDE;
+            for (int col = 2; col <= 6 && (_castling & rights); col += 4)
+            {
+                Move m = {{row, 4}, {row, col}};
+                if (castling_allowed(m))
+                {
+                    co_yield m;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Adds a piece's move to a list of moves. A pawn reaching the last row can become any of four pieces, so it adds
+ * one move for each.
+ *
+ * @param piece The piece being moved.
+ * @param location Location of the square it's moved to.
+ * @param moves The list to add to.
+ */
+void Board::add_move(const Piece *piece, pair<int, int> location, vector<Move> &moves)
+{
+    if (piece->name() == PAWN && (location.first == 0 || location.first == 7))
+    {
+        for (char promotion : {QUEEN, ROOK, BISHOP, KNIGHT})
+        {
+            moves.push_back({piece->location(), location, promotion});
+        }
+        return;
+    }
+
+    moves.push_back({piece->location(), location});
+}
+
+/**
+ * Works out which castling rights are lost when a piece moves from or to a square. Moving the king loses both of
+ * its player's rights, and moving a rook, or capturing it, loses the right to castle with it.
+ *
+ * @param location The square.
+ * @return The castling rights that survive, as a mask.
+ */
+static int castlingKept(pair<int, int> location)
+{
+    if (location == make_pair(0, 4))
+    {
+        return ~(WHITE_KINGSIDE | WHITE_QUEENSIDE);
+    }
+    if (location == make_pair(7, 4))
+    {
+        return ~(BLACK_KINGSIDE | BLACK_QUEENSIDE);
+    }
+    if (location == make_pair(0, 7))
+    {
+        return ~WHITE_KINGSIDE;
+    }
+    if (location == make_pair(0, 0))
+    {
+        return ~WHITE_QUEENSIDE;
+    }
+    if (location == make_pair(7, 7))
+    {
+        return ~BLACK_KINGSIDE;
+    }
+    if (location == make_pair(7, 0))
+    {
+        return ~BLACK_QUEENSIDE;
+    }
+    return ALL_CASTLING;
+}
+
+/**
+ * Moves a piece without checking any of the rules of chess, capturing whatever was on the square being moved to.
+ * This is meant for moves that are already known to be legal, like the ones returned by legal_moves().
+ * The turn then passes to the other player, and the move counters, castling rights, and en passant square are
+ * brought up to date.
+ *
+ * A king moving two squares sideways castles, taking the rook along with it. A pawn moving diagonally onto an
+ * empty square captures en passant. A pawn reaching the last row becomes the piece the move names, or a queen.
+ *
+ * @param m The move to make.
+ */
+void Board::apply(Move m)
+{
+    Square *move_from = &_squares[m.from.first][m.from.second];
+    Square *move_to = &_squares[m.to.first][m.to.second];
+    const Piece *piece = move_from->piece();
+    bool pawn = piece->name() == PAWN;
+
+    // Captures and pawn moves can't be undone, so they reset the halfmove clock.
+    _halfmove_clock++;
+    if (move_to->occupied() || pawn)
+    {
+        _halfmove_clock = 0;
+    }
+
+    if (move_to->occupied())
+    {
+        remove_piece(move_to);
+    }
+
+    // The pawn captured en passant is beside the one capturing it, not on the square it moves to.
+    else if (pawn && m.from.second != m.to.second)
+    {
+        remove_piece(&_squares[m.from.first][m.to.second]);
+    }
+
+    // The rook jumps over the king to the square it passed through.
+    if (piece->name() == KING && abs(m.to.second - m.from.second) == 2)
+    {
+        move_piece({m.from.first, m.to.second > m.from.second ? 7 : 0}, {m.from.first, (m.from.second + m.to.second) / 2});
+    }
+
+    move_piece(m.from, m.to);
+
+    if (pawn && (m.to.first == 0 || m.to.first == 7))
+    {
+        promote(move_to, m.promotion ? m.promotion : QUEEN);
+    }
+
+    _castling &= castlingKept(m.from) & castlingKept(m.to);
+    _en_passant = pawn && abs(m.to.first - m.from.first) == 2 ? (m.from.first + m.to.first) / 2 * 8 + m.from.second : -1;
+
+    if (_turn == BLACK)
+    {
+        _fullmove++;
+    }
+
+    _turn = opponent(_turn);
+    _mobility = -1;
+}
+
+/**
+ * Counts the positions reachable from this one in exactly a number of moves, by playing out every legal move.
+ * The counts for well-known positions have been worked out by other engines, so any difference points to a bug
+ * in the move generator.
+ *
+ * @param depth Number of moves to look ahead.
+ * @return Number of positions reached.
+ */
+long long Board::perft(int depth)
+{
+    if (depth <= 0)
+    {
+        return 1;
+    }
+
+    vector<Move> moves;
+    legal_moves(_turn, moves);
+
+    if (depth == 1)
+    {
+        return moves.size();
+    }
+
+    long long nodes = 0;
+    for (auto it = moves.begin(); it != moves.end(); ++it)
+    {
+        Board next(*this);
+        next.apply(*it);
+        nodes += next.perft(depth - 1);
+    }
+
+    return nodes;
+}
+
+/**
+ * Explains to the player why a move was rejected.
+ * @param error Reason the move was rejected.
+ * @return The explanation. Empty if the move wasn't rejected.
+ */
+const char *moveErrorMessage(MoveError error)
+{
+    switch (error)
+    {
+    case MOVE_OFF_BOARD:
+        return "Invalid command. Please input [?] without the brackets if you need help.";
+    case MOVE_NO_PIECE:
+        return "There is no piece on that square.";
+    case MOVE_NOT_YOUR_PIECE:
+        return "That's not your piece.";
+    case MOVE_UNREACHABLE:
+        return "That piece's movement doesn't allow it to reach that square.";
+    case MOVE_BLOCKED:
+        return "That piece is blocked from reaching that square.";
+    case MOVE_PAWN_CAPTURE:
+        return "A pawn can only capture another piece by moving forward diagonally one space.";
+    case MOVE_OWN_PIECE:
+        return "You cannot capture your own piece.";
+    case MOVE_SUICIDE_CAPTURE:
+        return "Trying to capture that piece would render your king vulnerable to capture.";
+    case MOVE_SUICIDE:
+        return "Moving that piece there would render your king vulnerable to capture.";
+    case MOVE_CASTLING:
+        return "You can only castle if neither your king nor that rook has moved, nothing is between them, and your king isn't in check and doesn't pass through or land on an attacked square.";
+    case MOVE_PROMOTION:
+        return "A pawn reaching the last row can only become a queen, rook, bishop, or knight, and no other move can promote.";
+    default:
+        return "";
+    }
+}
+
 /**
  * Prompts the user to press ENTER to proceed.
  * Usually happens because the user has been given some text to read, but no other input option to proceed, therefore
@@ -946,6 +2019,7 @@ int Board::is_check(Piece *move_from_piece)
  */
 void pressEnterToContinue()
 {
+    TraceScope trace("pause");
     cout << "\nPress ENTER to continue";
     cin.get();
     cin.clear();
@@ -1,56 +1,232 @@
 #ifndef BOARD_H
 #define BOARD_H
 
+#include "move.h"
+#include "movegen.h"
 #include "piece.h"
 #include "square.h"
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <type_traits>
+
+// Reasons a move can be rejected by Board::try_move().
+enum MoveError
+{
+    MOVE_OK,              // The move was made.
+    MOVE_OFF_BOARD,       // One of the squares isn't on the 8x8 board.
+    MOVE_NO_PIECE,        // There is no piece on the square being moved from.
+    MOVE_NOT_YOUR_PIECE,  // The piece being moved belongs to the other player.
+    MOVE_UNREACHABLE,     // The piece's movement doesn't allow it to reach the square.
+    MOVE_BLOCKED,         // Another piece is in the way.
+    MOVE_PAWN_CAPTURE,    // A pawn is trying to capture straight ahead, or move diagonally without capturing.
+    MOVE_OWN_PIECE,       // The piece is trying to capture a friendly piece.
+    MOVE_SUICIDE_CAPTURE, // The capture would render the player's king vulnerable.
+    MOVE_SUICIDE,         // The move would render the player's king vulnerable.
+    MOVE_CASTLING,        // The king is trying to castle, but isn't allowed to right now.
+    MOVE_PROMOTION        // The promotion asked for isn't a queen, rook, bishop, or knight, or the move isn't a pawn reaching the last row.
+};
+
+// Castling rights, as bits that can be combined. A right is lost for good once the king or that rook moves.
+const int WHITE_KINGSIDE = 1;  // White may castle with the rook on h1.
+const int WHITE_QUEENSIDE = 2; // White may castle with the rook on a1.
+const int BLACK_KINGSIDE = 4;  // Black may castle with the rook on h8.
+const int BLACK_QUEENSIDE = 8; // Black may castle with the rook on a8.
+const int ALL_CASTLING = 15;   // Every castling right, as at the start of a game.
+
+// What happened when a move was attempted.
+struct MoveResult
+{
+    MoveError error; // Why the move was rejected. MOVE_OK if it was made.
+    int outcome;     // Movement outcome code defined in piece.h. BAD if the move was rejected.
+    char captured;   // Name of the piece that was captured. 0 if nothing was.
+};
+
+// Most pieces of one type a player can have: the two rooks, bishops, or knights they start with, plus eight
+// promoted pawns.
+const int MAX_PIECES_OF_TYPE = 10;
+
+// The pieces one player has on the board, kept as the numbers of the squares they're on (row * 8 + column), with
+// a separate list for each type in the order of PIECE_NAMES. Unlike pointers, square numbers stay right when the
+// board is copied. The lists aren't kept in any order, so a piece can be taken out by moving the last one of its
+// type into its place.
+struct PieceList
+{
+    unsigned char squares[PIECE_TYPES][MAX_PIECES_OF_TYPE]; // Square each piece of each type is on.
+    unsigned char counts[PIECE_TYPES];                      // Number of pieces of each type.
+};
+
+// Some of a player's pieces, looked at through the squares of the board they're on. Iterating over it gives a
+// pointer to each piece in turn, one type after another. It only lasts as long as the board it came from is left
+// alone.
+class PieceRange
+{
+private:
+    // Attributes.
+    const Square *_squares; // Every square on the board, numbered row * 8 + column.
+    const PieceList *_list; // The pieces' square numbers.
+    int _first;             // First type of piece in the range, as an index into PIECE_NAMES.
+    int _last;              // Just past the last type of piece in the range.
+
+public:
+    // Walks through the pieces in the list, skipping over types the player has none of.
+    class iterator
+    {
+    private:
+        const Square *_squares; // Every square on the board, numbered row * 8 + column.
+        const PieceList *_list; // The pieces' square numbers.
+        int _type;              // Type of the piece the iterator is at.
+        int _last;              // Just past the last type of piece to visit.
+        int _index;             // Place of the piece the iterator is at among the pieces of its type.
+
+        // Moves on to the next type with any pieces left, once every piece of the current one has been visited.
+        void skip_empty()
+        {
+            while (_type < _last && _index >= _list->counts[_type])
+            {
+                _type++;
+                _index = 0;
+            }
+        }
+
+    public:
+        iterator(const Square *squares, const PieceList *list, int type, int last) : _squares(squares), _list(list), _type(type), _last(last), _index(0)
+        {
+            skip_empty();
+        }
+
+        const Piece *operator*() const { return _squares[_list->squares[_type][_index]].piece(); }
+        iterator &operator++()
+        {
+            ++_index;
+            skip_empty();
+            return *this;
+        }
+        bool operator==(const iterator &other) const { return _type == other._type && _index == other._index; }
+        bool operator!=(const iterator &other) const { return !(*this == other); }
+    };
+
+    // Constructor for the pieces of the types from first up to but not including last.
+    PieceRange(const Square *squares, const PieceList &list, int first = 0, int last = PIECE_TYPES) : _squares(squares), _list(&list), _first(first), _last(last) {}
+
+    iterator begin() const { return iterator(_squares, _list, _first, _last); } // First piece.
+    iterator end() const { return iterator(_squares, _list, _last, _last); }    // Just past the last piece.
+    bool empty() const { return begin() == end(); }                             // Whether or not there are no pieces at all.
+
+    // Number of pieces.
+    size_t size() const
+    {
+        size_t count = 0;
+        for (int type = _first; type < _last; type++)
+        {
+            count += _list->counts[type];
+        }
+        return count;
+    }
+};
+
+// FEN string for the standard starting position.
+const string STARTING_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Largest halfmove clock or fullmove number a FEN string can hold. Real games never get near it, and keeping both to
+// four digits puts a bound on how long a FEN string can get.
+const int MAX_FEN_CLOCK = 9999;
+
+// Most characters Board::to_fen() ever writes: eight rows of eight characters with a slash between each, the player
+// to move, every castling right, an en passant square, and both clocks at MAX_FEN_CLOCK, each after a space.
+const int MAX_FEN_LENGTH = 8 * 8 + 7 + 2 + 5 + 3 + 2 * 5;
 
 // The actual chess board.
 //
 // A board contains 8 rows and 8 columns of squares.
 // A square can either be occupied or not occupied by a piece.
-// A board also keeps track of all the uncaptured white pieces,
-// uncaptured black pieces, captured white pieces, and captured black pieces.
+// A board also keeps track of all the uncaptured white pieces and
+// uncaptured black pieces. The captured ones are whatever is missing from them.
+//
+// Every piece lives in the square it's on, and everything else refers to squares by number, so nothing on a board
+// points anywhere. Copying a board is a plain copy of a few hundred bytes, and can just as well be done with memcpy.
 class Board
 {
 private:
     // Attributes.
-    int _rows;                       // There are 8 rows on a chess board.
-    int _cols;                       // There are 8 columns on a chess board.
-    vector<vector<Square>> _squares; // An individual square on the board.
-    vector<Piece *> _white;          // All white pieces currently on the board.
-    vector<Piece *> _black;          // All black pieces currently on the board.
-    vector<char> _white_captured;    // Names of all white pieces that have been captured by black.
-    vector<char> _black_captured;    // Names of all black pieces that have been captured by white.
+    int _rows;                // There are 8 rows on a chess board.
+    int _cols;                // There are 8 columns on a chess board.
+    Square _squares[8][8];    // An individual square on the board.
+    PieceList _white;         // All white pieces currently on the board.
+    PieceList _black;         // All black pieces currently on the board.
+    unsigned char _index[64]; // Place of the piece on each square among its player's pieces of its type. Only means anything for occupied squares.
+    char _turn;               // Color whose turn it is. Can be 'W' or 'B'.
+    int _halfmove_clock;      // Number of moves since the last capture or pawn move.
+    int _fullmove;            // Number of the current move. Starts at 1 and goes up after black moves.
+    int _castling;            // Castling rights both players still have, as a combination of the bits above.
+    int _en_passant;          // Number (row * 8 + column) of the square a pawn just skipped over by moving two squares, which an enemy pawn may capture onto. -1 if there isn't one.
+    signed char _mobility;    // Whether the player to move has any legal move: 1 if they do, 0 if they don't, -1 if it hasn't been worked out yet.
+
+    void add_piece(const Piece &piece);                                              // Put a new piece on the board, on the square it says it's on.
+    void remove_piece(Square *square);                                               // Take the piece on a square off the board.
+    void move_piece(pair<int, int> from, pair<int, int> to);                         // Move a piece to an empty square, keeping its player's list of pieces up to date.
+    void promote(Square *square, char name);                                         // Replace the pawn on a square with a new piece of the given type.
+    void clear();                                                                    // Remove every piece from the board.
+    bool castling_allowed(Move m);                                                   // Check if a king move two squares sideways is a legal castle.
+    bool en_passant_allowed(Move m);                                                 // Check if a pawn capturing onto the en passant square leaves its king safe.
+    void special_moves(char color, vector<Move> &moves);                             // Add every legal castle and en passant capture for the given color.
+    bool find_legal_move(char color);                                                // Check if the given color has any legal move, stopping at the first one found.
+    void add_move(const Piece *piece, pair<int, int> location, vector<Move> &moves); // Add a move to a list, once for each piece a pawn can be promoted to.
 
 public:
-    // Constructor and destructor.
-    Board();  // Default constructor.
-    ~Board(); // Default destructor.
+    // Constructors. Boards are copied with the implicit copy constructor and assignment operator.
+    Board();                           // Default constructor.
+    explicit Board(const string &fen); // Constructor for the position described by a FEN string. Throws invalid_argument if it can't be read.
 
-    // These initializers are called by the board's default constructor.
-    void init_pieces(); // Initialize the pieces by creating all the initial chess pieces and adding them to _white and _black.
-    void init_board();  // Initialize the board by linking each initial square to its matching piece.
+    // This initializer is called by the board's default constructor.
+    void init_pieces(); // Initialize the pieces by putting all the initial chess pieces on their starting squares.
 
     // Print functions.
     void print_board(ostream &out) const;    // Print the board and its contents in a readable format.
     void print_active(ostream &out) const;   // Print a list of the active pieces for both white and black.
     void print_captured(ostream &out) const; // Print a list of the captured pieces for both white and black.
 
+    // FEN functions.
+    bool set_fen(const string &fen); // Set up the position described by a FEN string. Return false and leave the board untouched if it can't be read.
+    string to_fen() const;           // Describe the current position as a FEN string.
+    uint64_t hash() const;           // Compute a 64-bit hash of the pieces, whose turn it is, castling rights, and en passant. Equal positions always hash the same.
+
     // Getter functions..
-    int rows() const { return _rows; }    // Retrieve the integer value for rows that this board holds.
-    int columns() const { return _cols; } // Retrieve the integer value for columns that this board holds.
+    int rows() const { return _rows; }                                                                        // Retrieve the integer value for rows that this board holds.
+    int columns() const { return _cols; }                                                                     // Retrieve the integer value for columns that this board holds.
+    char turn() const { return _turn; }                                                                       // Retrieve the color whose turn it is.
+    int halfmove_clock() const { return _halfmove_clock; }                                                    // Retrieve the number of moves since the last capture or pawn move.
+    int fullmove() const { return _fullmove; }                                                                // Retrieve the number of the current move.
+    int castling() const { return _castling; }                                                                // Retrieve the castling rights both players still have.
+    pair<int, int> en_passant() const;                                                                        // Retrieve the square a pawn may capture onto en passant. {-1, -1} if there isn't one.
+    PieceRange white() const { return PieceRange(&_squares[0][0], _white); }                                  // Retrieve all white pieces currently on the board.
+    PieceRange black() const { return PieceRange(&_squares[0][0], _black); }                                  // Retrieve all black pieces currently on the board.
+    PieceRange pieces(char color, char name) const;                                                           // Retrieve the pieces of one type the given color has on the board.
+    int captured(char color, char name) const;                                                                // Retrieve the number of pieces of one type the given color has lost.
+    const Square &square(pair<int, int> location) const { return _squares[location.first][location.second]; } // Retrieve the square at a location.
 
     // Play functions.
-    void play_human(); // Play a game of chess between two human players locally.
-    void play_ai();    // Play a game of chess between a human player and AI locally.
+    void play_human(istream &in = cin, ostream &out = cout, bool interactive = true); // Play a game of chess between two human players, reading commands from in. Pauses and drawing are skipped if not interactive.
+    void play_ai();                                                                   // Play a game of chess between a human player and AI locally.
 
     // Other functions.
-    int move(char color, string first, string second);                                         // Attempt to move a chess piece from one location to another. Return -1 if fail, 0 if good, 1 if check, 2 if checkmate, 3 if stalemate.
-    bool is_suicide(Piece *move_from_piece, Piece *move_to_piece, pair<int, int> move_to_loc); // Check if the player's king is vulnerable. Return true if vulnerable.
-    bool is_checkmate(char color);                                                             // Check if the player is in checkmate. Return true if in checkmate.
-    int is_check(Piece *move_from_piece);                                                      // Check if the player is in check. Return 0 if good, 1 if check, 2 if checkmate, 3 if stalemate.
+    MoveResult try_move(Move m);                                                                           // Attempt to move a chess piece for the player whose turn it is. Never prints or waits on the player.
+    bool is_suicide(const Piece *move_from_piece, const Piece *move_to_piece, pair<int, int> move_to_loc); // Check if the player's king is vulnerable. Return true if vulnerable.
+    bool is_checkmate(char color);                                                                         // Check if the player is in checkmate. Return true if in checkmate.
+    int is_check(const Piece *move_from_piece);                                                            // Check if the player is in check. Return 0 if good, 1 if check, 2 if checkmate, 3 if stalemate.
+    bool in_check(char color);                                                                             // Check if the king of the given color can currently be captured.
+    bool has_legal_move();                                                                                 // Check if the player to move has any legal move. Only worked out once per position.
+    vector<Move> legal_moves(char color);                                                                  // List every move the given color can make without rendering its king vulnerable.
+    void legal_moves(char color, vector<Move> &moves);                                                     // Same as above, but fill a buffer the caller keeps around instead of allocating a new one.
+    MoveGenerator generate_moves(char color, bool staged = true);                                          // Same as above, but work the moves out one at a time as they're asked for, captures first if staged.
+    void apply(Move m);                                                                                    // Move a piece without checking the rules and pass the turn. The move should come from legal_moves().
+    long long perft(int depth);                                                                            // Count the positions reachable in exactly depth moves, for checking the move generator against known counts.
 };
 
+// Boards are copied into every search, thread, and job that needs one, so copying one must never cost more than copying its bytes.
+static_assert(is_trivially_copyable<Board>::value, "Board must be trivially copyable");
+
+const char *moveErrorMessage(MoveError error); // Explains to the player why a move was rejected.
 void pressEnterToContinue();                   // Pauses the game until the player presses the ENTER key on their keyboard.
 bool checkMoveCoords(char first, char second); // Checks to see if the coordinates given are within the boundaries of the 8x8 chess board.
 
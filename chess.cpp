@@ -14,20 +14,32 @@
  *      * Notify player of check.
  *      * Allow players to forfeit or draw.
  *      * Stalemate condition.
+ *      * Special moves: castling, pawn promotion, and en passant.
+ *      * Draw conditions: threefold repetition, fifty-move rule.
  *      * Prevent player from moving king into a position to be captured.
  *      * Tracker for captured and uncaptured pieces.
  *      * Navigatable command-based menus.
  *      * Other stuff.
  *
  * Features that didn't make it:
- *      * Special moves: castling, pawn promotion, or en passant.
- *      * Draw conditions: threefold repetition, fifty-move rule.
  *      * AI
  *      * Non-broken input parser. The current method in which input is parsed is very easy to segfault.
  */
 
+#include "archive.h"
+#include "bench.h"
 #include "board.h"
+#include "epd.h"
+#include "match.h"
+#include "mate.h"
+#include "pgn.h"
+#include "positions.h"
+#include "script.h"
+#include "server.h"
+#include "trace.h"
+#include "uci.h"
 #include <iostream>
+#include <string>
 using namespace std;
 
 bool checkOptionSelected(int option, int optionCount);
@@ -36,6 +48,126 @@ void printPieceInfo();
 
 int main(int argc, char **argv)
 {
+    // Record a timeline of whatever follows, and write it out as a Chrome trace when the program exits.
+    if (argc > 2 && string(argv[1]) == "--trace")
+    {
+        if (!startTrace(argv[2]))
+        {
+            cout << "Couldn't write a trace to " << argv[2] << "." << endl;
+            return 1;
+        }
+
+        traceThreadName("main");
+        argc -= 2;
+        argv += 2;
+        argv[0] = argv[-2];
+    }
+
+    // Speak the Universal Chess Interface instead of showing the menus, so the game can be plugged into a chess GUI.
+    if (argc > 1 && string(argv[1]) == "--uci")
+    {
+        Uci uci;
+        uci.run();
+        return 0;
+    }
+
+    // Play a file of commands through the local two-player game without any pauses, and print where it ended up.
+    if (argc > 2 && string(argv[1]) == "--script")
+    {
+        return runScript(argv[2], argc > 3 && string(argv[3]) == "quiet");
+    }
+
+    // Replay every game in a PGN file through the rules and report on them. The number of threads is optional.
+    if (argc > 2 && string(argv[1]) == "--pgn")
+    {
+        return replayPgn(argv[2], argc > 3 ? atoi(argv[3]) : 0);
+    }
+
+    // Pack every clean game in a PGN file into a binary archive. "compact" packs each move into one byte instead of two.
+    if (argc > 3 && string(argv[1]) == "--archive")
+    {
+        return writeArchive(argv[2], argv[3], argc > 4 && string(argv[4]) == "compact" ? ENCODING_INDEX : ENCODING_SQUARE, 0);
+    }
+
+    // Replay every game in a binary archive and report on them. The number of threads is optional.
+    if (argc > 2 && string(argv[1]) == "--replay")
+    {
+        return replayArchive(argv[2], argc > 3 ? atoi(argv[3]) : 0);
+    }
+
+    // Record every position reached in an archive's games into a position index. The number of threads is optional.
+    if (argc > 3 && string(argv[1]) == "--index")
+    {
+        return buildPositionIndex(argv[2], argv[3], argc > 4 ? atoi(argv[4]) : 0);
+    }
+
+    // Find every game in an archive that reached a position, using its position index.
+    if (argc > 4 && string(argv[1]) == "--lookup")
+    {
+        return lookupPosition(argv[2], argv[3], argv[4]);
+    }
+
+    // Play the engine against itself from a file of openings until the SPRT reaches a verdict or the games run out.
+    // Engines A and B each get a time control, like "10+0.1" or "d3". Everything after the openings file is optional.
+    if (argc > 2 && string(argv[1]) == "--match")
+    {
+        TimeControl tc[2];
+        SprtSettings sprt = {0, 20, 0.05, 0.05};
+
+        if (!parseTimeControl(argc > 4 ? argv[4] : "10+0.1", tc[0]) || !parseTimeControl(argc > 5 ? argv[5] : argc > 4 ? argv[4] : "10+0.1", tc[1]))
+        {
+            cout << "Time controls look like 10+0.1 (seconds plus increment) or d3 (fixed depth)." << endl;
+            return 1;
+        }
+
+        return runMatch(argv[2], argc > 3 ? atoll(argv[3]) : 1000, tc, sprt, argc > 6 ? atoi(argv[6]) : 0);
+    }
+
+    // Search a fixed set of positions to a fixed depth and print the node count, which only changes if the search does.
+    if (argc > 1 && (string(argv[1]) == "bench" || string(argv[1]) == "--bench"))
+    {
+        return runBench(argc > 2 ? atoi(argv[2]) : BENCH_DEPTH);
+    }
+
+    // Count every position reachable in a number of moves, from the start or a FEN string, to check the rules against known counts.
+    if (argc > 2 && string(argv[1]) == "--perft")
+    {
+        return runPerft(atoi(argv[2]), argc > 3 ? argv[3] : STARTING_FEN);
+    }
+
+    // Search every position in an EPD test suite for a fixed time each, and report how many the engine solved.
+    if (argc > 2 && string(argv[1]) == "--epdtest")
+    {
+        return runEpdTest(argv[2], argc > 3 ? atoi(argv[3]) : 1000, argc > 4 ? atoi(argv[4]) : 0);
+    }
+
+    // Prove or refute a forced mate in a number of moves from a position. Threads and "all" (try quiet moves too) are optional.
+    if (argc > 3 && (string(argv[1]) == "mate" || string(argv[1]) == "--mate"))
+    {
+        bool all = argc > 4 && string(argv[argc - 1]) == "all";
+        return runMateSolver(atoi(argv[2]), argv[3], argc > 4 && !(argc == 5 && all) ? atoi(argv[4]) : 0, all ? MATE_ALL_MOVES : MATE_CHECKS);
+    }
+
+    // Host games for lots of clients at once over a TCP port on localhost or a Unix socket.
+    if (argc > 2 && string(argv[1]) == "--server")
+    {
+        GameServer server;
+        if (!server.listen(argv[2]))
+        {
+            cout << "Couldn't listen on " << argv[2] << "." << endl;
+            return 1;
+        }
+
+        server.run();
+        return 0;
+    }
+
+    // Play games against a running server and report how quickly it replies. Connections and requests are optional.
+    if (argc > 2 && string(argv[1]) == "--loadgen")
+    {
+        return runLoadGenerator(argv[2], argc > 3 ? atoi(argv[3]) : 100, argc > 4 ? atoll(argv[4]) : 100000);
+    }
+
     // This is the entire chess game's loop. It can only be stopped by inputting
     // the option for "Exit" from the main menu.
     //
@@ -0,0 +1,270 @@
+#include "epd.h"
+#include "pgn.h"
+#include "search.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+using namespace std;
+
+/**
+ * Reads the moves listed by a bm or am operation, written in standard algebraic notation.
+ *
+ * @param board The position the moves are played in.
+ * @param operands The moves, separated by spaces.
+ * @param moves Every move that could be read is added to it.
+ * @return Whether or not every move could be read.
+ */
+static bool readEpdMoves(Board &board, const string &operands, vector<Move> &moves)
+{
+    istringstream in(operands);
+    string san;
+    bool ok = true;
+
+    while (in >> san)
+    {
+        san.erase(san.find_last_not_of("+#!?") + 1);
+
+        Move m;
+        if (san.empty() || parseSan(board, san, m) != GOOD)
+        {
+            ok = false;
+            continue;
+        }
+
+        moves.push_back(m);
+    }
+
+    return ok;
+}
+
+/**
+ * Reads a test suite in EPD format. Each line holds the first four fields of a FEN string, followed by operations
+ * separated by semicolons, like: 2k5/8/8/8/8/8/8/K1R5 w - - bm Rc7+; id "test 1";
+ *
+ * Positions without a bm or am operation have nothing to test, so they're skipped. So are ones whose moves can't be
+ * read, since the search could never find them.
+ *
+ * @param path Path of the file to read.
+ * @param positions Filled with every position that can be tested.
+ * @return Whether or not the file could be read.
+ */
+bool loadEpd(const string &path, vector<EpdPosition> &positions)
+{
+    ifstream in(path);
+    if (!in)
+    {
+        return false;
+    }
+
+    Board board;
+    string line;
+    int number = 0;
+
+    while (getline(in, line))
+    {
+        number++;
+
+        // The position is the first four fields. Everything after them is operations.
+        istringstream fields(line);
+        string placement, turn, castling, en_passant;
+        if (!(fields >> placement >> turn >> castling >> en_passant) || placement[0] == '#')
+        {
+            continue;
+        }
+
+        EpdPosition position;
+        position.id = "line " + to_string(number);
+        position.fen = placement + " " + turn + " " + castling + " " + en_passant + " 0 1";
+
+        if (!board.set_fen(position.fen))
+        {
+            cout << "Invalid position on line " << number << " of " << path << "." << endl;
+            continue;
+        }
+
+        string rest;
+        getline(fields, rest);
+
+        bool ok = true;
+        istringstream operations(rest);
+        string operation;
+        while (getline(operations, operation, ';'))
+        {
+            istringstream words(operation);
+            string opcode, operands;
+            if (!(words >> opcode))
+            {
+                continue;
+            }
+            getline(words, operands);
+
+            if (opcode == "bm")
+            {
+                ok = readEpdMoves(board, operands, position.best) && ok;
+            }
+            else if (opcode == "am")
+            {
+                ok = readEpdMoves(board, operands, position.avoid) && ok;
+            }
+            else if (opcode == "id")
+            {
+                size_t open = operands.find('"');
+                size_t close = operands.rfind('"');
+                position.id = open != string::npos && close > open ? operands.substr(open + 1, close - open - 1) : operands;
+            }
+        }
+
+        if (!ok)
+        {
+            cout << "Skipping " << position.id << ": it has a move that couldn't be read or isn't supported." << endl;
+            continue;
+        }
+
+        if (!position.best.empty() || !position.avoid.empty())
+        {
+            positions.push_back(position);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Checks if a move solves a test position: it has to be one of the best moves, if any are given, and none of the
+ * moves to avoid.
+ *
+ * @param position The test position.
+ * @param m The move to check.
+ * @return Whether or not the move solves the position.
+ */
+static bool solves(const EpdPosition &position, Move m)
+{
+    if (!position.best.empty() && find(position.best.begin(), position.best.end(), m) == position.best.end())
+    {
+        return false;
+    }
+
+    return find(position.avoid.begin(), position.avoid.end(), m) == position.avoid.end();
+}
+
+/**
+ * Searches a test position for a fixed amount of time, and works out how long it took to find the solution.
+ *
+ * The search may switch between moves as it looks deeper, so the time to solution is when it last switched to a
+ * solving move and then stuck with it until the end.
+ *
+ * @param position The test position.
+ * @param movetime Milliseconds to search for.
+ * @return How the search did.
+ */
+EpdResult solveEpd(const EpdPosition &position, int movetime)
+{
+    Board board(position.fen);
+    Search search;
+    EpdResult epd = {false, {{-1, -1}, {-1, -1}}, 0, 0, 0, 0, 0};
+    bool settled = false; // True while every iteration since the last switch has found a solving move.
+
+    SearchResult result = search.run(board, board.turn(), {0, movetime, NULL}, [&](const SearchResult &iteration) {
+        if (!solves(position, iteration.best))
+        {
+            settled = false;
+        }
+        else if (!settled)
+        {
+            settled = true;
+            epd.solve_nodes = iteration.nodes;
+            epd.solve_time = iteration.time;
+        }
+    });
+
+    epd.move = result.best;
+    epd.depth = result.depth;
+    epd.nodes = result.nodes;
+    epd.time = result.time;
+    epd.solved = result.best.from.first >= 0 && settled;
+
+    if (!epd.solved)
+    {
+        epd.solve_nodes = 0;
+        epd.solve_time = 0;
+    }
+
+    return epd;
+}
+
+/**
+ * Runs every position in a test suite through the search and reports how many it solved and how quickly.
+ *
+ * Every position gets its own board and search, so they're spread across a pool of threads, and only printing is
+ * locked. Each search gets the same amount of time however many threads there are, so with fewer positions than
+ * threads, or only one core, the results are the same either way.
+ *
+ * @param path Path of the EPD file.
+ * @param movetime Milliseconds to search each position for.
+ * @param threads Number of worker threads. If 0, one per core is used.
+ * @return 0 if the suite was run, 1 otherwise.
+ */
+int runEpdTest(const string &path, int movetime, int threads)
+{
+    vector<EpdPosition> positions;
+    if (!loadEpd(path, positions))
+    {
+        cout << "Couldn't open " << path << "." << endl;
+        return 1;
+    }
+
+    if (positions.empty())
+    {
+        cout << "No testable positions in " << path << "." << endl;
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    vector<EpdResult> results(positions.size());
+    mutex print_mutex;
+
+    cout << "Testing " << positions.size() << " positions for " << movetime << " ms each with " << pool.size() << " threads." << endl;
+
+    auto start = chrono::steady_clock::now();
+    pool.run(positions.size(), [&](size_t item, int) {
+        EpdResult &epd = results[item] = solveEpd(positions[item], movetime);
+
+        lock_guard<mutex> lock(print_mutex);
+        cout << positions[item].id << ": " << (epd.move.from.first < 0 ? "(none)" : moveName(epd.move)) << " at depth "
+             << epd.depth << ", " << (epd.solved ? "solved" : "failed");
+        if (epd.solved)
+        {
+            cout << " after " << epd.solve_time << " ms and " << epd.solve_nodes << " nodes";
+        }
+        cout << endl;
+    });
+    long long elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+
+    long long solved = 0;
+    long long solve_time = 0;
+    long long solve_nodes = 0;
+    long long search_time = 0;
+    for (auto it = results.begin(); it != results.end(); ++it)
+    {
+        search_time += it->time;
+        if (it->solved)
+        {
+            solved++;
+            solve_time += it->solve_time;
+            solve_nodes += it->solve_nodes;
+        }
+    }
+
+    cout << "Solved " << solved << " of " << positions.size() << " in " << elapsed << " ms." << endl;
+    if (solved)
+    {
+        cout << "Average time to solution " << solve_time / solved << " ms, average nodes to solution " << solve_nodes / solved << "." << endl;
+    }
+    cout << "Solved per second of search: " << (search_time ? solved * 1000.0 / search_time : 0.0) << endl;
+
+    return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef EPD_H
+#define EPD_H
+
+#include "board.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+// A test position read from an EPD file.
+struct EpdPosition
+{
+    string id;          // Name of the position, from its id operation. Its line number if it doesn't have one.
+    string fen;         // The position, as a full FEN string.
+    vector<Move> best;  // Moves that solve the position, from its bm operation. Any one of them will do.
+    vector<Move> avoid; // Moves that fail the position, from its am operation.
+};
+
+// How the search did on one test position.
+struct EpdResult
+{
+    bool solved;           // True if the move found at the end of the search solves the position.
+    Move move;             // Move found at the end of the search.
+    int depth;             // Depth of the last finished iteration.
+    long long nodes;       // Positions visited by the whole search.
+    long long time;        // Milliseconds spent on the whole search.
+    long long solve_nodes; // Positions visited by the time the search settled on a solving move for good. Only set if solved.
+    long long solve_time;  // Milliseconds spent by the time the search settled on a solving move for good. Only set if solved.
+};
+
+bool loadEpd(const string &path, vector<EpdPosition> &positions); // Read every position in an EPD file that has a bm or am operation.
+EpdResult solveEpd(const EpdPosition &position, int movetime);    // Search a test position for a number of milliseconds and see whether the move found solves it.
+int runEpdTest(const string &path, int movetime, int threads);    // Run a test suite across a pool of threads and report on it.
+
+#endif // EPD_H
@@ -0,0 +1,52 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+// Number of moves in a row, counting both players', without a capture or a pawn move that draws the game.
+const int FIFTY_MOVE_PLIES = 100;
+
+// The hashes of every position a game has passed through, for spotting repeated positions.
+//
+// A capture or a pawn move can never be undone, so no position from before the last one can come back. The
+// board's halfmove clock counts the moves since then, so checking for a repetition only ever looks at that many
+// hashes, no matter how long the game has gone on.
+class PositionHistory
+{
+private:
+    // Attributes.
+    vector<uint64_t> _hashes; // Board::hash() of every position before the current one, oldest first.
+
+public:
+    // Record the position a move is about to be made from, and forget it again once the move is taken back.
+    void push(uint64_t hash) { _hashes.push_back(hash); }
+    void pop() { _hashes.pop_back(); }
+    void clear() { _hashes.clear(); }
+
+    /**
+     * Counts how many times a position has come up before. Only positions with the same player to move can match,
+     * so every other one is skipped.
+     *
+     * @param hash Board::hash() of the current position.
+     * @param halfmove_clock The current position's halfmove clock.
+     * @return Number of earlier times the position was reached.
+     */
+    int repetitions(uint64_t hash, int halfmove_clock) const
+    {
+        int found = 0;
+        int oldest = max(0, static_cast<int>(_hashes.size()) - halfmove_clock);
+        for (int i = static_cast<int>(_hashes.size()) - 2; i >= oldest; i -= 2)
+        {
+            if (_hashes[i] == hash)
+            {
+                found++;
+            }
+        }
+        return found;
+    }
+};
+
+#endif // HISTORY_H
@@ -0,0 +1,230 @@
+#include "libchess.h"
+#include "board.h"
+#include "search.h"
+#include <cstring>
+#include <new>
+using namespace std;
+
+// The C interface's limits have to be written out in C, so make sure they still match the board's.
+static_assert(CHESS_FEN_CLOCK_MAX == MAX_FEN_CLOCK, "CHESS_FEN_CLOCK_MAX must match MAX_FEN_CLOCK");
+static_assert(CHESS_FEN_MAX == MAX_FEN_LENGTH + 1, "CHESS_FEN_MAX must hold the longest FEN string and its NUL");
+
+// What a chess_board handle points to. The move buffer is kept so that listing moves doesn't allocate every time.
+struct chess_board
+{
+    Board board;             // The position.
+    vector<Move> moves;      // Scratch buffer for legal moves.
+    Search search;           // Search used by chess_board_best_move(), kept so its buffers are reused.
+    PositionHistory history; // Positions the board went through since its position was last set, for spotting repetitions.
+};
+
+/**
+ * Converts a move from the C interface's square numbers to board locations.
+ * @param move The move to convert. Squares past 63 end up off the board, where try_move() rejects them.
+ * @return The move as the board sees it.
+ */
+static Move toMove(chess_move move)
+{
+    return {{move.from / 8, move.from % 8}, {move.to / 8, move.to % 8}, move.promotion};
+}
+
+/**
+ * Converts a move from board locations to the C interface's square numbers.
+ * @param m The move to convert.
+ * @return The move as the C interface sees it.
+ */
+static chess_move fromMove(Move m)
+{
+    chess_move move;
+    move.from = static_cast<unsigned char>(m.from.first * 8 + m.from.second);
+    move.to = static_cast<unsigned char>(m.to.first * 8 + m.to.second);
+    move.promotion = m.promotion;
+    return move;
+}
+
+int chess_api_version(void)
+{
+    return CHESS_API_VERSION;
+}
+
+chess_board *chess_board_create(void)
+{
+    // Nothing may be thrown across the C boundary.
+    try
+    {
+        return new chess_board();
+    }
+    catch (...)
+    {
+        return NULL;
+    }
+}
+
+void chess_board_destroy(chess_board *board)
+{
+    delete board;
+}
+
+int chess_board_set_fen(chess_board *board, const char *fen)
+{
+    if (!board || !fen)
+    {
+        return 0;
+    }
+
+    try
+    {
+        if (!board->board.set_fen(fen))
+        {
+            return 0;
+        }
+
+        board->history.clear();
+        return 1;
+    }
+    catch (...)
+    {
+        return 0;
+    }
+}
+
+size_t chess_board_get_fen(const chess_board *board, char *buffer, size_t size)
+{
+    if (!board)
+    {
+        return 0;
+    }
+
+    try
+    {
+        string fen = board->board.to_fen();
+        if (buffer && size > 0)
+        {
+            size_t length = min(fen.size(), size - 1);
+            memcpy(buffer, fen.data(), length);
+            buffer[length] = '\0';
+        }
+        return fen.size();
+    }
+    catch (...)
+    {
+        if (buffer && size > 0)
+        {
+            buffer[0] = '\0';
+        }
+        return 0;
+    }
+}
+
+char chess_board_turn(const chess_board *board)
+{
+    return board ? board->board.turn() : 0;
+}
+
+int chess_board_apply_move(chess_board *board, chess_move move)
+{
+    if (!board || move.from > 63 || move.to > 63)
+    {
+        return CHESS_BAD;
+    }
+
+    try
+    {
+        uint64_t before = board->board.hash();
+        MoveResult result = board->board.try_move(toMove(move));
+        if (result.error == MOVE_OK)
+        {
+            board->history.push(before);
+        }
+        return result.outcome;
+    }
+    catch (...)
+    {
+        return CHESS_BAD;
+    }
+}
+
+size_t chess_board_legal_moves(chess_board *board, chess_move *moves, size_t capacity)
+{
+    if (!board)
+    {
+        return 0;
+    }
+
+    try
+    {
+        board->board.legal_moves(board->board.turn(), board->moves);
+    }
+    catch (...)
+    {
+        return 0;
+    }
+
+    size_t count = board->moves.size();
+    for (size_t i = 0; moves && i < count && i < capacity; i++)
+    {
+        moves[i] = fromMove(board->moves[i]);
+    }
+
+    return count;
+}
+
+int chess_board_best_move(chess_board *board, int depth, int movetime, chess_move *move)
+{
+    if (!board)
+    {
+        return 0;
+    }
+
+    try
+    {
+        SearchLimits limits = {max(depth, 0), max(movetime, 0), NULL};
+        if (!limits.depth && !limits.movetime)
+        {
+            limits.depth = 4;
+        }
+
+        SearchResult result = board->search.run(board->board, board->board.turn(), limits, nullptr, &board->history);
+        if (result.best.from.first < 0)
+        {
+            return 0;
+        }
+
+        if (move)
+        {
+            *move = fromMove(result.best);
+        }
+        return 1;
+    }
+    catch (...)
+    {
+        return 0;
+    }
+}
+
+int chess_move_parse(const char *text, chess_move *move)
+{
+    Move m;
+    if (!text || !parseMove(text, m))
+    {
+        return 0;
+    }
+
+    if (move)
+    {
+        *move = fromMove(m);
+    }
+    return 1;
+}
+
+void chess_move_name(chess_move move, char buffer[CHESS_MOVE_NAME_MAX])
+{
+    if (move.from > 63 || move.to > 63 || (move.promotion && !strchr("QRBN", move.promotion)))
+    {
+        buffer[0] = '\0';
+        return;
+    }
+
+    string name = moveName(toMove(move));
+    memcpy(buffer, name.c_str(), name.size() + 1);
+}
@@ -0,0 +1,75 @@
+#ifndef LIBCHESS_H
+#define LIBCHESS_H
+
+/* C interface to the rules engine and search, for linking libchess into programs that aren't written in C++.
+ *
+ * Boards are opaque handles. Anything handed back, like a list of moves or a FEN string, is written into a buffer
+ * the caller owns, so memory is never allocated on one side of the boundary and freed on the other. Functions that
+ * fill a buffer return how much room they needed, so the caller can tell when it was too small.
+ *
+ * Squares are numbered from 0 (a1) to 63 (h8), going across each row from a to h, starting at row 1.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Version of this interface. It only goes up when existing functions change. */
+#define CHESS_API_VERSION 2
+
+/* Movement outcome codes, the same ones as in piece.h. */
+#define CHESS_BAD -1      /* The move isn't legal. */
+#define CHESS_GOOD 0      /* The move was made. */
+#define CHESS_CHECK 1     /* The move was made, and the opponent is in check. */
+#define CHESS_CHECKMATE 2 /* The move was made, and the opponent is in checkmate. */
+#define CHESS_STALEMATE 3 /* The move was made, and the opponent has no legal moves but isn't in check. */
+
+/* Largest halfmove clock or fullmove number a FEN string can hold. Boards turn away FEN strings with larger ones, and
+ * write clocks that have run past it during play as this. */
+#define CHESS_FEN_CLOCK_MAX 9999
+
+/* Longest FEN string a board can produce, plus its terminating NUL: eight rows of eight characters with a slash
+ * between each, the player to move, every castling right, an en passant square, and both clocks at their 4-digit
+ * CHESS_FEN_CLOCK_MAX, each after a space. */
+#define CHESS_FEN_MAX (8 * 8 + 7 + 2 + 5 + 3 + 2 * (1 + 4) + 1)
+
+/* Most legal moves any position can have. */
+#define CHESS_MOVES_MAX 256
+
+/* Longest name of a move, like "e7e8q", plus its terminating NUL. */
+#define CHESS_MOVE_NAME_MAX 6
+
+typedef struct chess_board chess_board;
+
+/* A move from one square to another. A pawn reaching the last row becomes the piece named by promotion: 'Q', 'R',
+ * 'B', or 'N'. If promotion is 0, it becomes a queen. Castling is the king's move, two squares toward the rook. */
+typedef struct chess_move
+{
+    unsigned char from;
+    unsigned char to;
+    char promotion;
+} chess_move;
+
+int chess_api_version(void); /* Return CHESS_API_VERSION as it was when the library was built. */
+
+chess_board *chess_board_create(void);        /* Create a board holding the starting position. Return NULL if out of memory. */
+void chess_board_destroy(chess_board *board); /* Destroy a board. Does nothing if board is NULL. */
+
+int chess_board_set_fen(chess_board *board, const char *fen);                  /* Set up a position from a FEN string. Return 1 on success, or 0 and leave the board untouched. */
+size_t chess_board_get_fen(const chess_board *board, char *buffer, size_t size); /* Write the position's FEN string into buffer, NUL-terminated and cut short if needed. Return its full length, which is size or more if it was cut short. */
+char chess_board_turn(const chess_board *board);                               /* Return 'W' if it's white's turn, or 'B' if it's black's. */
+
+int chess_board_apply_move(chess_board *board, chess_move move);                          /* Make a move for the player whose turn it is. Return a CHESS_ outcome code. The board is untouched if it's CHESS_BAD. */
+size_t chess_board_legal_moves(chess_board *board, chess_move *moves, size_t capacity);   /* Write up to capacity legal moves for the player whose turn it is into moves. Return how many there are. */
+int chess_board_best_move(chess_board *board, int depth, int movetime, chess_move *move); /* Search for the best move, to a depth, for a number of milliseconds, or both (depth 4 if neither is given). Return 0 if there are no legal moves. */
+
+int chess_move_parse(const char *text, chess_move *move);                  /* Read a move like "e2e4" or "e7e8q". Return 1 on success, 0 otherwise. */
+void chess_move_name(chess_move move, char buffer[CHESS_MOVE_NAME_MAX]); /* Write a move like "e2e4" or "e7e8q" into buffer, NUL-terminated. */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBCHESS_H */
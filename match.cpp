@@ -0,0 +1,323 @@
+#include "match.h"
+#include "search.h"
+#include "threadpool.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+using namespace std;
+
+/**
+ * Reads a time control, either as seconds on the clock plus seconds of increment, like "10+0.1", or as a fixed
+ * search depth, like "d3".
+ *
+ * @param text The time control to read.
+ * @param tc Set to the time control.
+ * @return Whether or not the time control could be read.
+ */
+bool parseTimeControl(const string &text, TimeControl &tc)
+{
+    tc = {0, 0, 0};
+
+    if (!text.empty() && text[0] == 'd')
+    {
+        tc.depth = atoi(text.c_str() + 1);
+        return tc.depth > 0 && tc.depth <= MAX_DEPTH;
+    }
+
+    size_t plus = text.find('+');
+    tc.base = static_cast<int>(atof(text.substr(0, plus).c_str()) * 1000);
+    tc.increment = plus == string::npos ? 0 : static_cast<int>(atof(text.c_str() + plus + 1) * 1000);
+    return tc.base > 0 && tc.increment >= 0;
+}
+
+/**
+ * Reads the starting positions for a match: one FEN per line. Blank lines and lines starting with # are skipped.
+ *
+ * @param path Path of the file to read.
+ * @param openings Filled with every position in the file.
+ * @return Whether or not the file could be read, every position in it makes sense, and there's at least one.
+ */
+bool loadOpenings(const string &path, vector<string> &openings)
+{
+    ifstream in(path);
+    string line;
+    Board board;
+
+    while (getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        if (!board.set_fen(line))
+        {
+            cout << "Invalid FEN in " << path << ": " << line << endl;
+            return false;
+        }
+
+        openings.push_back(line);
+    }
+
+    return !openings.empty();
+}
+
+/**
+ * Plays one game between engines A and B, each searching on its own clock.
+ *
+ * Every move gets a slice of the time left on the clock plus half the increment, the same way the UCI mode
+ * spends its time. An engine whose clock runs out loses. Games are drawn by threefold repetition, by the fifty-move
+ * rule, or once they reach MAX_GAME_PLIES.
+ *
+ * @param fen Starting position.
+ * @param tc Time controls for engines A and B, in that order.
+ * @param a_white True if engine A plays white.
+ * @param reason Set to why the game ended.
+ * @return 1 if engine A wins, 0 for a draw, and -1 if engine B wins.
+ */
+int playGame(const string &fen, const TimeControl tc[2], bool a_white, string &reason)
+{
+    Board board(fen);
+    Search search;
+    PositionHistory history; // Every position the game has been in before the current one.
+    int clock[2] = {tc[0].base, tc[1].base}; // Milliseconds left for engines A and B.
+
+    for (int ply = 0; ply < MAX_GAME_PLIES; ply++)
+    {
+        int engine = (board.turn() == WHITE) != a_white; // 0 for engine A, 1 for engine B.
+        int sign = engine == 0 ? 1 : -1;                 // Result of the game if the engine to move wins.
+        SearchLimits limits = {tc[engine].depth, 0, NULL};
+
+        if (!tc[engine].depth)
+        {
+            limits.movetime = max(1, min(clock[engine] / 30 + tc[engine].increment / 2, clock[engine] - 10));
+        }
+
+        auto start = chrono::steady_clock::now();
+        SearchResult result = search.run(board, board.turn(), limits, nullptr, &history);
+        int elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+
+        // This only happens in a starting position that's already over.
+        if (result.best.from.first < 0)
+        {
+            reason = board.in_check(board.turn()) ? "checkmate" : "stalemate";
+            return board.in_check(board.turn()) ? -sign : 0;
+        }
+
+        if (!tc[engine].depth)
+        {
+            clock[engine] -= elapsed;
+            if (clock[engine] < 0)
+            {
+                reason = "time forfeit";
+                return -sign;
+            }
+
+            clock[engine] += tc[engine].increment;
+        }
+
+        history.push(board.hash());
+        MoveResult move = board.try_move(result.best);
+
+        if (move.outcome == CHECKMATE)
+        {
+            reason = "checkmate";
+            return sign;
+        }
+
+        if (move.outcome == STALEMATE)
+        {
+            reason = "stalemate";
+            return 0;
+        }
+
+        if (history.repetitions(board.hash(), board.halfmove_clock()) >= 2)
+        {
+            reason = "threefold repetition";
+            return 0;
+        }
+
+        if (board.halfmove_clock() >= FIFTY_MOVE_PLIES)
+        {
+            reason = "fifty-move rule";
+            return 0;
+        }
+    }
+
+    reason = "move limit";
+    return 0;
+}
+
+/**
+ * Works out the fraction of the points engine A has scored, and how spread out the result of a single game is.
+ *
+ * @param score Results so far.
+ * @param variance Set to the variance of the result of a single game.
+ * @return Fraction of the points scored by engine A.
+ */
+static double scoreFraction(const MatchScore &score, double &variance)
+{
+    double games = score.wins + score.draws + score.losses;
+    double x = (score.wins + score.draws / 2.0) / games;
+
+    variance = (score.wins * pow(1 - x, 2) + score.draws * pow(0.5 - x, 2) + score.losses * pow(x, 2)) / games;
+    return x;
+}
+
+/**
+ * Turns a fraction of the points scored into an Elo difference, using the logistic curve Elo ratings are based on.
+ * @param x Fraction of the points scored, strictly between 0 and 1.
+ * @return The Elo difference.
+ */
+static double elo(double x)
+{
+    return 400 * log10(x / (1 - x));
+}
+
+/**
+ * Estimates the Elo difference between engines A and B from the games played so far.
+ *
+ * @param score Results so far.
+ * @param margin If not NULL, set to half the width of the 95% confidence interval.
+ * @return The estimated Elo difference. Positive if A is stronger.
+ */
+double eloDifference(const MatchScore &score, double *margin)
+{
+    double games = score.wins + score.draws + score.losses;
+    if (games == 0)
+    {
+        if (margin)
+        {
+            *margin = 0;
+        }
+        return 0;
+    }
+
+    double variance;
+    double x = scoreFraction(score, variance);
+
+    // A clean sweep either way doesn't say how big the difference is.
+    x = min(max(x, 0.5 / games), 1 - 0.5 / games);
+
+    if (margin)
+    {
+        double spread = 1.959964 * sqrt(variance / games);
+        double low = max(x - spread, 1e-6);
+        double high = min(x + spread, 1 - 1e-6);
+        *margin = (elo(high) - elo(low)) / 2;
+    }
+
+    return elo(x);
+}
+
+/**
+ * Works out the log likelihood ratio of the Elo difference being elo1 rather than elo0, using the normal
+ * approximation to the distribution of the score. Once it drops below log(beta / (1 - alpha)), elo0 is accepted.
+ * Once it rises above log((1 - beta) / alpha), elo1 is.
+ *
+ * @param score Results so far.
+ * @param sprt The hypotheses being tested.
+ * @return The log likelihood ratio. 0 until there's enough to go on.
+ */
+double sprtLlr(const MatchScore &score, const SprtSettings &sprt)
+{
+    double games = score.wins + score.draws + score.losses;
+    if (games == 0)
+    {
+        return 0;
+    }
+
+    double variance;
+    double x = scoreFraction(score, variance);
+
+    // Until the games have had different results, there's nothing to measure the spread by.
+    if (variance <= 0)
+    {
+        return 0;
+    }
+
+    double s0 = 1 / (1 + pow(10, -sprt.elo0 / 400));
+    double s1 = 1 / (1 + pow(10, -sprt.elo1 / 400));
+    return games * (s1 - s0) * (2 * x - s0 - s1) / (2 * variance);
+}
+
+/**
+ * Plays a match between engines A and B and prints a running report on it.
+ *
+ * Each opening is played twice, with the engines swapping colors, so neither gets the better side of it more often.
+ * Games are spread across a pool of threads. Every game has its own board and searches, so the only thing the
+ * workers share is the score, which is locked while it's updated. Once the SPRT reaches a verdict, no more games
+ * are started.
+ *
+ * @param openings_path Path of the file of starting positions.
+ * @param games Most games to play.
+ * @param tc Time controls for engines A and B, in that order.
+ * @param sprt The hypotheses to test.
+ * @param threads Number of worker threads. If 0, one per core is used.
+ * @return 0 if the match was played, 1 otherwise.
+ */
+int runMatch(const string &openings_path, long long games, const TimeControl tc[2], const SprtSettings &sprt, int threads)
+{
+    vector<string> openings;
+    if (!loadOpenings(openings_path, openings))
+    {
+        cout << "Couldn't read any openings from " << openings_path << "." << endl;
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    MatchScore score = {0, 0, 0};
+    mutex score_mutex;
+    atomic<bool> decided(false);
+    double lower = log(sprt.beta / (1 - sprt.alpha)); // Accept elo0 once the LLR drops below this.
+    double upper = log((1 - sprt.beta) / sprt.alpha); // Accept elo1 once the LLR rises above this.
+    string verdict = "no verdict";
+
+    cout << "Playing up to " << games << " games from " << openings.size() << " openings with " << pool.size()
+         << " threads. SPRT elo0 " << sprt.elo0 << ", elo1 " << sprt.elo1 << ", bounds [" << lower << ", " << upper << "]." << endl;
+
+    pool.run(games, [&](size_t item, int) {
+        if (decided)
+        {
+            return;
+        }
+
+        string reason;
+        bool a_white = item % 2 == 0;
+        int result = playGame(openings[item / 2 % openings.size()], tc, a_white, reason);
+
+        lock_guard<mutex> lock(score_mutex);
+        if (decided)
+        {
+            return;
+        }
+
+        (result > 0 ? score.wins : result < 0 ? score.losses : score.draws)++;
+
+        double margin;
+        double difference = eloDifference(score, &margin);
+        double llr = sprtLlr(score, sprt);
+        long long played = score.wins + score.draws + score.losses;
+
+        cout << "Game " << item + 1 << " (A " << (a_white ? "white" : "black") << "): "
+             << (result > 0 ? "A wins" : result < 0 ? "B wins" : "draw") << " by " << reason << ". "
+             << "Score after " << played << ": +" << score.wins << " =" << score.draws << " -" << score.losses
+             << ", Elo " << difference << " +/- " << margin << ", LLR " << llr << endl;
+
+        if (llr <= lower || llr >= upper)
+        {
+            verdict = llr >= upper ? "H1 accepted: A is stronger by at least elo1" : "H0 accepted: A is no stronger than elo0";
+            decided = true;
+        }
+    });
+
+    double margin;
+    double difference = eloDifference(score, &margin);
+    cout << "Final score: +" << score.wins << " =" << score.draws << " -" << score.losses << ". Elo difference "
+         << difference << " +/- " << margin << ". SPRT: " << verdict << "." << endl;
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef MATCH_H
+#define MATCH_H
+
+#include "board.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+// Games that go on this long without ending are scored as draws.
+const int MAX_GAME_PLIES = 400;
+
+// How long an engine gets to think in a match.
+struct TimeControl
+{
+    int base;      // Milliseconds on the clock at the start of the game. 0 if the engine searches to a fixed depth instead.
+    int increment; // Milliseconds added to the clock after every move.
+    int depth;     // Depth to search every move to. 0 if the engine is on the clock instead.
+};
+
+// Settings for a sequential probability ratio test, which decides between two hypotheses about the Elo difference
+// between the engines as soon as the games played so far are enough to tell them apart.
+struct SprtSettings
+{
+    double elo0;  // Elo difference if engine A is no better than engine B.
+    double elo1;  // Elo difference if engine A is better than engine B.
+    double alpha; // Chance of accepting elo1 when elo0 is true.
+    double beta;  // Chance of accepting elo0 when elo1 is true.
+};
+
+// Results of a match so far, from engine A's point of view.
+struct MatchScore
+{
+    long long wins;
+    long long draws;
+    long long losses;
+};
+
+bool parseTimeControl(const string &text, TimeControl &tc);                             // Read a time control like "10+0.1" (seconds) or "d3" (fixed depth).
+bool loadOpenings(const string &path, vector<string> &openings);                        // Read one FEN per line from a file, skipping blank lines and comments.
+int playGame(const string &fen, const TimeControl tc[2], bool a_white, string &reason); // Play one game between engines A and B. Return 1 if A wins, 0 for a draw, -1 if B wins.
+double eloDifference(const MatchScore &score, double *margin);                          // Estimate the Elo difference between A and B, with its 95% error margin.
+double sprtLlr(const MatchScore &score, const SprtSettings &sprt);                      // Log likelihood ratio of elo1 over elo0 given the games so far.
+
+int runMatch(const string &openings_path, long long games, const TimeControl tc[2], const SprtSettings &sprt, int threads); // Play a match across a pool of threads and report on it.
+
+#endif // MATCH_H
@@ -0,0 +1,409 @@
+#include "mate.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+using namespace std;
+
+/**
+ * Checks if the king of the given color is attacked, by looking outward from the king for an enemy piece that
+ * could capture it. That only looks at the squares around the king rather than at every enemy piece's moves, so
+ * it's much quicker than Board::in_check(), which matters when every move has to be checked for giving check.
+ *
+ * @param board The board.
+ * @param color Color of the king.
+ * @return Whether or not the king is attacked.
+ */
+bool givesCheck(const Board &board, char color)
+{
+    const int knight[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+    const int lines[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}}; // Rows and columns first, then diagonals.
+
+    pair<int, int> king = (*board.pieces(color, KING).begin())->location();
+    char enemy = opponent(color);
+
+    // Checks if the square at an offset from the king holds an enemy piece of one of two types.
+    auto holds = [&](int rows, int cols, char name, char other) {
+        pair<int, int> location = {king.first + rows, king.second + cols};
+        if (!checkBounds(location) || !board.square(location).occupied())
+        {
+            return false;
+        }
+
+        const Piece *piece = board.square(location).piece();
+        return piece->color() == enemy && (piece->name() == name || piece->name() == other);
+    };
+
+    for (int i = 0; i < 8; i++)
+    {
+        if (holds(knight[i][0], knight[i][1], KNIGHT, KNIGHT) || holds(lines[i][0], lines[i][1], KING, KING))
+        {
+            return true;
+        }
+    }
+
+    // Enemy pawns capture toward the king's side of the board.
+    int forward = color == WHITE ? 1 : -1;
+    if (holds(forward, -1, PAWN, PAWN) || holds(forward, 1, PAWN, PAWN))
+    {
+        return true;
+    }
+
+    // Only the first piece along each line can reach the king.
+    for (int i = 0; i < 8; i++)
+    {
+        for (int step = 1; step < 8; step++)
+        {
+            pair<int, int> location = {king.first + lines[i][0] * step, king.second + lines[i][1] * step};
+            if (!checkBounds(location))
+            {
+                break;
+            }
+
+            if (board.square(location).occupied())
+            {
+                if (holds(lines[i][0] * step, lines[i][1] * step, QUEEN, i < 4 ? ROOK : BISHOP))
+                {
+                    return true;
+                }
+                break;
+            }
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Checks if the search has been told to stop. Once it has, every position is treated as unsolved, and nothing
+ * more is recorded, since a search that was cut short hasn't proven or refuted anything.
+ *
+ * @return Whether or not the search should stop.
+ */
+bool MateSolver::stopped()
+{
+    if (!_stopped && _stop && _stop->load(memory_order_relaxed))
+    {
+        _stopped = true;
+    }
+    return _stopped;
+}
+
+/**
+ * Makes the search stop once a flag is set by another thread.
+ *
+ * @param stop The flag. May be NULL, so the search never stops early.
+ */
+void MateSolver::set_stop(const atomic<bool> *stop)
+{
+    _stop = stop;
+    _stopped = false;
+}
+
+/**
+ * Lists the attacker's moves worth trying, along with the positions they lead to, best first.
+ *
+ * Moves that leave the defender the fewest replies come first, since those are the quickest to prove a mate after,
+ * and the most likely to lead to one. Moves that don't give check are only listed when every move is being tried,
+ * and then come after every check. With a single move left, only a mate will do, and that has to give check.
+ *
+ * @param board The position, with the attacker to move.
+ * @param moves Number of moves the attacker has left to mate in.
+ * @return The moves. They're kept until moves are next listed for the same number of moves left.
+ */
+vector<MateCandidate> &MateSolver::candidates(Board &board, int moves)
+{
+    vector<MateCandidate> &list = _candidates[moves - 1];
+    char defender = opponent(board.turn());
+    list.clear();
+
+    for (const Move &m : board.generate_moves(board.turn(), false))
+    {
+        MateCandidate candidate = {m, board, false, 0};
+        candidate.after.apply(m);
+        candidate.check = givesCheck(candidate.after, defender);
+
+        if (!candidate.check && (_which == MATE_CHECKS || moves == 1))
+        {
+            continue;
+        }
+
+        // Only whether there are any replies at all matters with a single move left.
+        if (moves == 1)
+        {
+            candidate.replies = candidate.after.has_legal_move();
+        }
+        else
+        {
+            candidate.after.legal_moves(defender, _replies);
+            candidate.replies = _replies.size();
+        }
+
+        list.push_back(candidate);
+    }
+
+    stable_sort(list.begin(), list.end(), [](const MateCandidate &a, const MateCandidate &b) {
+        return a.check != b.check ? a.check : a.replies < b.replies;
+    });
+    return list;
+}
+
+/**
+ * Checks if the attacker, whose turn it is, can force mate within a number of moves: an OR node, solved as soon as
+ * any one move works.
+ *
+ * @param board The position.
+ * @param moves Number of moves the attacker has to mate in.
+ * @return Whether or not the attacker can force mate. Always false once the search has been told to stop.
+ */
+bool MateSolver::attack(Board &board, int moves)
+{
+    _nodes++;
+    if (stopped())
+    {
+        return false;
+    }
+
+    uint64_t hash = board.hash();
+    auto found = _table.find(hash);
+    if (found != _table.end() && (found->second.proven <= moves || found->second.refuted >= moves))
+    {
+        return found->second.proven <= moves;
+    }
+
+    bool mate = false;
+    vector<MateCandidate> &list = candidates(board, moves);
+    for (size_t i = 0; i < list.size() && !mate; i++)
+    {
+        // No replies is checkmate after a check, and a stalemate after anything else.
+        mate = list[i].replies == 0 ? list[i].check : moves > 1 && defend(list[i].after, moves - 1);
+    }
+
+    if (stopped())
+    {
+        return false;
+    }
+
+    Known &known = _table.try_emplace(hash, Known{MAX_MATE_MOVES + 1, -1}).first->second;
+    if (mate)
+    {
+        known.proven = min<int>(known.proven, moves);
+    }
+    else
+    {
+        known.refuted = max<int>(known.refuted, moves);
+    }
+    return mate;
+}
+
+/**
+ * Checks if the attacker can force mate within a number of moves whatever the defender, whose turn it is, does:
+ * an AND node, refuted as soon as any one reply escapes. The replies are worked out one at a time, captures first,
+ * so once one escapes the rest are never even listed.
+ *
+ * @param board The position.
+ * @param moves Number of moves the attacker has left to mate in. 0 means the defender has to be mated already.
+ * @return Whether or not the attacker can force mate. Always false once the search has been told to stop.
+ */
+bool MateSolver::defend(Board &board, int moves)
+{
+    _nodes++;
+    if (stopped())
+    {
+        return false;
+    }
+
+    char defender = board.turn();
+    if (moves == 0)
+    {
+        return givesCheck(board, defender) && !board.has_legal_move();
+    }
+
+    uint64_t hash = board.hash();
+    auto found = _table.find(hash);
+    if (found != _table.end() && (found->second.proven <= moves || found->second.refuted >= moves))
+    {
+        return found->second.proven <= moves;
+    }
+
+    bool mate = true;
+    bool escapes = false; // Whether the defender has any legal reply at all.
+    for (const Move &m : board.generate_moves(defender))
+    {
+        escapes = true;
+        Board after(board);
+        after.apply(m);
+        if (!attack(after, moves))
+        {
+            mate = false;
+            break;
+        }
+    }
+
+    // A defender with no replies is already mated, or stalemated.
+    if (!escapes)
+    {
+        mate = givesCheck(board, defender);
+    }
+
+    if (stopped())
+    {
+        return false;
+    }
+
+    Known &known = _table.try_emplace(hash, Known{MAX_MATE_MOVES + 1, -1}).first->second;
+    if (mate)
+    {
+        known.proven = min<int>(known.proven, moves);
+    }
+    else
+    {
+        known.refuted = max<int>(known.refuted, moves);
+    }
+    return mate;
+}
+
+/**
+ * Prints the quickest mating move from a position, followed by every reply the defender has to it, each on a line
+ * of its own and followed in turn by the attacker's answer to it.
+ *
+ * @param board The position, with the attacker to move.
+ * @param moves Number of moves the attacker has to mate in.
+ * @param number Number of the attacker's move, counting from 1 at the start of the solution.
+ * @param indent How deep in the solution the position is, for indenting the replies.
+ * @param out The stream to write to.
+ */
+void MateSolver::print_attack(Board &board, int moves, int number, int indent, ostream &out)
+{
+    for (int left = 1; left <= moves; left++)
+    {
+        // Printing the replies lists moves again for fewer moves left, so this keeps its own copy.
+        vector<MateCandidate> list = candidates(board, left);
+        for (MateCandidate &candidate : list)
+        {
+            bool mate = candidate.check && candidate.replies == 0;
+            if (!mate && (candidate.replies == 0 || left == 1 || !defend(candidate.after, left - 1)))
+            {
+                continue;
+            }
+
+            out << number << ". " << moveName(candidate.move) << (mate ? "#" : candidate.check ? "+" : "");
+            if (!mate)
+            {
+                for (const Move &reply : candidate.after.legal_moves(candidate.after.turn()))
+                {
+                    Board after(candidate.after);
+                    after.apply(reply);
+                    out << "\n" << string(4 * (indent + 1), ' ') << number << "... " << moveName(reply) << " ";
+                    print_attack(after, left - 1, number + 1, indent + 1, out);
+                }
+            }
+            return;
+        }
+    }
+
+    out << "(no mate)";
+}
+
+/**
+ * Prints every line of a proven mate: the attacker's move, every reply to it, the attacker's answer to each of
+ * those, and so on down to the mates. The attacker always plays the quickest mate there is.
+ *
+ * @param board The position, with the attacker to move.
+ * @param moves Number of moves the mate was proven in.
+ * @param out The stream to write to.
+ */
+void MateSolver::print_solution(Board &board, int moves, ostream &out)
+{
+    print_attack(board, moves, 1, 0, out);
+    out << endl;
+}
+
+/**
+ * Looks for a forced mate from a position in one move, then two, and so on up to a limit, so the first mate found
+ * is the quickest. The attacker's first moves are spread across a pool of threads, each with a solver of its own.
+ * As soon as one of them proves a mate the rest stop, and the whole solution is printed.
+ *
+ * @param moves Most moves the mate can take.
+ * @param fen The position, with the attacker to move.
+ * @param threads Number of worker threads. If 0, one per core is used.
+ * @param which Which of the attacker's moves are tried.
+ * @return 0 once the position is solved or refuted, 1 if the number of moves or position doesn't make sense.
+ */
+int runMateSolver(int moves, const string &fen, int threads, MateMoves which)
+{
+    Board board;
+    if (moves < 1 || moves > MAX_MATE_MOVES || !board.set_fen(fen))
+    {
+        cout << "The mate solver needs between 1 and " << MAX_MATE_MOVES << " moves and a valid FEN string." << endl;
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    vector<MateSolver> solvers(pool.size(), MateSolver(which));
+    MateSolver root_solver(which);
+
+    cout << "Looking for mate in " << moves << " or fewer, trying " << (which == MATE_CHECKS ? "only checks" : "every move")
+         << ", with " << pool.size() << " threads." << endl;
+
+    auto start = chrono::steady_clock::now();
+    int solved_in = 0;   // Number of moves the mate was found in. 0 until one is.
+    int solver = -1;     // Worker whose solver proved the mate.
+    long long nodes = 0; // Positions visited by every solver so far.
+
+    for (int n = 1; n <= moves && !solved_in; n++)
+    {
+        vector<MateCandidate> root = root_solver.candidates(board, n);
+        atomic<bool> found(false);
+        size_t best = root.size(); // Earliest of the first moves proven to mate.
+        mutex best_mutex;
+
+        pool.run(root.size(), [&](size_t item, int worker) {
+            MateSolver &mine = solvers[worker];
+            mine.set_stop(&found);
+
+            Board after(root[item].after);
+            bool mate = root[item].replies == 0 ? root[item].check : n > 1 && mine.defend(after, n - 1);
+            if (mate)
+            {
+                lock_guard<mutex> lock(best_mutex);
+                if (item < best)
+                {
+                    best = item;
+                    solver = worker;
+                }
+                found = true;
+            }
+        });
+
+        nodes = root_solver.nodes();
+        for (auto it = solvers.begin(); it != solvers.end(); ++it)
+        {
+            nodes += it->nodes();
+        }
+        long long elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+
+        cout << "Mate in " << n << ": " << (found ? moveName(root[best].move) : "none") << " after " << elapsed << " ms and "
+             << nodes << " positions." << endl;
+
+        if (found)
+        {
+            solved_in = n;
+        }
+    }
+
+    for (auto it = solvers.begin(); it != solvers.end(); ++it)
+    {
+        it->set_stop(NULL);
+    }
+
+    if (!solved_in)
+    {
+        cout << "No mate in " << moves << " or fewer" << (which == MATE_CHECKS ? " by checks alone. Add all to try every move." : ".") << endl;
+        return 0;
+    }
+
+    cout << "\nMate in " << solved_in << ":\n" << endl;
+    solvers[solver].print_solution(board, solved_in, cout);
+    return 0;
+}
@@ -0,0 +1,79 @@
+#ifndef MATE_H
+#define MATE_H
+
+#include "board.h"
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Most moves a mate search can look ahead.
+const int MAX_MATE_MOVES = 32;
+
+// Which of the attacker's moves a mate search tries. Mates in puzzles are nearly always a string of checks, and
+// only trying checks makes long mates quick to find. A mate with a quiet move in it can only be found by trying
+// every move.
+enum MateMoves
+{
+    MATE_CHECKS,   // Only moves that give check.
+    MATE_ALL_MOVES // Every legal move.
+};
+
+// One of the attacker's moves, along with the position it leads to.
+struct MateCandidate
+{
+    Move move;   // The move.
+    Board after; // Position after the move.
+    bool check;  // Whether or not the move gives check.
+    int replies; // Number of legal replies the defender has. Moves leaving fewer are tried first.
+};
+
+// Proves or refutes a forced mate in a number of moves, with an AND/OR search: the attacker needs one move that
+// mates against every defence, and the defender needs one reply that escapes.
+//
+// Nothing is scored, so a mate is either proven or it isn't. What's already known about every position visited is
+// kept in a table, both mates proven in so many moves and ones refuted, so positions reached by different move
+// orders are only solved once, and each deeper attempt builds on the ones before it. A solver is used by one thread
+// at a time, but several can work on the same position at once.
+class MateSolver
+{
+private:
+    // What's known about a position.
+    struct Known
+    {
+        signed char proven;  // Fewest moves a mate has been proven in. MAX_MATE_MOVES + 1 if none has.
+        signed char refuted; // Most moves a mate has been refuted in. -1 if none has.
+    };
+
+    // Attributes.
+    MateMoves _which;                                  // Which of the attacker's moves are tried.
+    unordered_map<uint64_t, Known> _table;             // What's known about every position visited, by Board::hash().
+    vector<MateCandidate> _candidates[MAX_MATE_MOVES]; // Attacker's moves at each number of moves left. Kept so listing them doesn't allocate.
+    vector<Move> _replies;                             // Scratch space for counting the defender's replies.
+    long long _nodes;                                  // Number of positions visited.
+    const atomic<bool> *_stop;                         // Set from another thread to abandon the search. May be NULL.
+    bool _stopped;                                     // True once the search has been abandoned. Nothing found after that is recorded.
+
+    bool stopped();                                                                   // Check if the search has been told to stop.
+    void print_attack(Board &board, int moves, int number, int indent, ostream &out); // Print the mating moves from a position with the attacker to move.
+
+public:
+    // Constructor.
+    explicit MateSolver(MateMoves which = MATE_CHECKS) : _which(which), _nodes(0), _stop(NULL), _stopped(false) {}
+
+    vector<MateCandidate> &candidates(Board &board, int moves);       // List the attacker's moves worth trying, best first.
+    bool attack(Board &board, int moves);                             // Check if the attacker, to move, can force mate in the given number of moves.
+    bool defend(Board &board, int moves);                             // Check if the attacker can force mate in the given number of moves whatever the defender, to move, does.
+    void print_solution(Board &board, int moves, ostream &out);       // Print every line of a proven mate, with the attacker to move.
+    void set_stop(const atomic<bool> *stop);                          // Abandon the search once stop is set, and forget any earlier search was abandoned.
+    bool was_stopped() const { return _stopped; }                     // Retrieve whether the search was abandoned.
+    long long nodes() const { return _nodes; }                        // Retrieve the number of positions visited so far.
+};
+
+bool givesCheck(const Board &board, char color);                               // Check if the king of the given color is attacked, looking outward from the king.
+int runMateSolver(int moves, const string &fen, int threads, MateMoves which); // Prove or refute mate in a number of moves from a position, and print the solution.
+
+#endif // MATE_H
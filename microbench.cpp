@@ -0,0 +1,363 @@
+/**
+ * microbench.cpp
+ *
+ * Microbenchmarks for the pieces' move generation and the board's check detection, so rewrites of piece.h and
+ * board.cpp can be compared against the code they replace. Built with make microbench.
+ *
+ * Every benchmark runs over the same set of positions. It's warmed up first, then timed over a number of samples,
+ * and the median time per call is reported along with how much the samples spread and how many heap allocations
+ * each call made.
+ */
+
+#include "board.h"
+#include "validate.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Constants controlling how long each benchmark runs.
+const int WARMUP_MS = 100; // Milliseconds spent running a benchmark before timing it.
+const int SAMPLES = 15;    // Number of timed samples taken of each benchmark.
+const int SAMPLE_MS = 20;  // Rough number of milliseconds each sample lasts.
+
+// Number of heap allocations made so far. The benchmarks only run on one thread.
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *memory = malloc(size ? size : 1);
+    if (!memory)
+    {
+        throw bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+// Positions every benchmark runs over: the start, an opening, two middlegames, a position with the king in check,
+// and an endgame.
+static const char *const POSITIONS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w - - 0 1",
+    "r1bqk1nr/pppp1ppp/2n5/2b1p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w - - 4 4",
+    "r2q1rk1/pp2bppp/2n1pn2/3p4/3P4/2NBPN2/PP3PPP/R2QK2R w - - 0 10",
+    "r1b2rk1/2q1bppp/p2p1n2/np2p3/3PP3/5N1P/PPBN1PP1/R1BQR1K1 b - - 0 13",
+    "rnb1kbnr/pppp1ppp/8/4p3/5PPq/8/PPPPP2P/RNBQKBNR w - - 1 3",
+    "8/5pk1/6p1/3R4/8/6P1/5PKP/3r4 b - - 0 40",
+};
+
+// Something for the results of the calls to go into, so the compiler can't throw the calls away.
+static volatile size_t sink = 0;
+
+// A benchmark: a batch of calls, which returns how many calls it made.
+struct Benchmark
+{
+    string name;              // Name of the benchmark.
+    function<size_t()> batch; // Runs one batch of calls.
+};
+
+// What one benchmark measured.
+struct Measurement
+{
+    double median; // Median nanoseconds per call across the samples.
+    double spread; // Standard deviation of the samples, as a fraction of their mean.
+    double allocs; // Heap allocations per call.
+};
+
+/**
+ * Runs a batch over and over for a while.
+ *
+ * @param batch The batch to run.
+ * @param ms Milliseconds to keep running for.
+ * @param batches Set to the number of batches run.
+ * @return Number of calls made.
+ */
+static size_t runFor(const function<size_t()> &batch, int ms, size_t &batches)
+{
+    auto end = chrono::steady_clock::now() + chrono::milliseconds(ms);
+    size_t calls = 0;
+    batches = 0;
+
+    do
+    {
+        calls += batch();
+        batches++;
+    } while (chrono::steady_clock::now() < end);
+
+    return calls;
+}
+
+/**
+ * Warms a benchmark up, then times it over a number of samples, each a fixed number of batches long.
+ *
+ * @param benchmark The benchmark to measure.
+ * @return What was measured.
+ */
+static Measurement measure(const Benchmark &benchmark)
+{
+    // Warming up also works out how many batches make up a sample of about the right length.
+    size_t batches;
+    runFor(benchmark.batch, WARMUP_MS, batches);
+    size_t per_sample = max<size_t>(1, batches * SAMPLE_MS / WARMUP_MS);
+
+    vector<double> samples;
+    size_t calls = 0;
+    size_t allocated = allocations;
+
+    for (int s = 0; s < SAMPLES; s++)
+    {
+        size_t sample_calls = 0;
+        auto start = chrono::steady_clock::now();
+        for (size_t b = 0; b < per_sample; b++)
+        {
+            sample_calls += benchmark.batch();
+        }
+        double ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+        samples.push_back(ns / max<size_t>(sample_calls, 1));
+        calls += sample_calls;
+    }
+
+    allocated = allocations - allocated;
+
+    double mean = 0;
+    for (double sample : samples)
+    {
+        mean += sample / samples.size();
+    }
+
+    double variance = 0;
+    for (double sample : samples)
+    {
+        variance += (sample - mean) * (sample - mean) / samples.size();
+    }
+
+    sort(samples.begin(), samples.end());
+    return {samples[samples.size() / 2], mean > 0 ? sqrt(variance) / mean : 0, static_cast<double>(allocated) / max<size_t>(calls, 1)};
+}
+
+/**
+ * Collects every piece of one type on a board, of both colors.
+ *
+ * @param board The board.
+ * @param name Name of the piece type.
+ * @return The pieces.
+ */
+static vector<const Piece *> piecesNamed(const Board &board, char name)
+{
+    vector<const Piece *> pieces;
+    for (char color : {WHITE, BLACK})
+    {
+        for (const Piece *piece : board.pieces(color, name))
+        {
+            pieces.push_back(piece);
+        }
+    }
+    return pieces;
+}
+
+int main()
+{
+    vector<Board> boards;
+    for (const char *fen : POSITIONS)
+    {
+        boards.push_back(Board(fen));
+    }
+
+    vector<Benchmark> benchmarks;
+    const pair<char, const char *> pieces[] = {{KING, "King"}, {QUEEN, "Queen"}, {ROOK, "Rook"}, {BISHOP, "Bishop"}, {KNIGHT, "Knight"}, {PAWN, "Pawn"}};
+
+    for (auto &piece : pieces)
+    {
+        // The pieces are found ahead of time, so finding them isn't part of what's measured.
+        vector<const Piece *> found;
+        for (Board &board : boards)
+        {
+            vector<const Piece *> on_board = piecesNamed(board, piece.first);
+            found.insert(found.end(), on_board.begin(), on_board.end());
+        }
+
+        // moveCheck() toward every square on the board, from every piece of the type.
+        benchmarks.push_back({string(piece.second) + "::moveCheck", [found]() {
+                                  for (const Piece *p : found)
+                                  {
+                                      for (int square = 0; square < 64; square++)
+                                      {
+                                          sink = sink + p->moveCheck({square / 8, square % 8}).size();
+                                      }
+                                  }
+                                  return found.size() * 64;
+                              }});
+
+        // allMoveCheck() from every piece of the type.
+        benchmarks.push_back({string(piece.second) + "::allMoveCheck", [found]() {
+                                  for (const Piece *p : found)
+                                  {
+                                      sink = sink + p->allMoveCheck().size();
+                                  }
+                                  return found.size();
+                              }});
+    }
+
+    // is_suicide() for every legal move in every position. The moves are worked out ahead of time.
+    struct SuicideCheck
+    {
+        Board *board;
+        const Piece *from;
+        const Piece *to;
+        pair<int, int> location;
+    };
+    vector<SuicideCheck> suicides;
+    for (Board &board : boards)
+    {
+        for (const Move &m : board.legal_moves(board.turn()))
+        {
+            suicides.push_back({&board, board.square(m.from).piece(), board.square(m.to).occupied() ? board.square(m.to).piece() : NULL, m.to});
+        }
+    }
+
+    benchmarks.push_back({"Board::is_suicide", [&suicides]() {
+                              for (const SuicideCheck &check : suicides)
+                              {
+                                  sink = sink + check.board->is_suicide(check.from, check.to, check.location);
+                              }
+                              return suicides.size();
+                          }});
+
+    // Every legal move for the player to move, listed all at once and then worked out one at a time.
+    vector<Move> buffer;
+    benchmarks.push_back({"Board::legal_moves", [&boards, &buffer]() {
+                              for (Board &board : boards)
+                              {
+                                  board.legal_moves(board.turn(), buffer);
+                                  sink = sink + buffer.size();
+                              }
+                              return boards.size();
+                          }});
+
+    benchmarks.push_back({"Board::generate_moves", [&boards]() {
+                              for (Board &board : boards)
+                              {
+                                  for (const Move &m : board.generate_moves(board.turn()))
+                                  {
+                                      sink = sink + m.to.first;
+                                  }
+                              }
+                              return boards.size();
+                          }});
+
+    // Only the first legal move, which is all a check for the end of the game needs.
+    benchmarks.push_back({"generate_moves (first)", [&boards]() {
+                              for (Board &board : boards)
+                              {
+                                  MoveGenerator moves = board.generate_moves(board.turn());
+                                  sink = sink + (moves.begin() != moves.end());
+                              }
+                              return boards.size();
+                          }});
+
+    // is_checkmate() for both colors. A board remembers whether the player to move can move, so each call gets a
+    // fresh copy that still has to work it out. Copying costs next to nothing beside the scan.
+    benchmarks.push_back({"Board::is_checkmate", [&boards]() {
+                              size_t calls = 0;
+                              for (const Board &board : boards)
+                              {
+                                  Board white = board;
+                                  Board black = board;
+                                  sink = sink + white.is_checkmate(WHITE) + black.is_checkmate(BLACK);
+                                  calls += 2;
+                              }
+                              return calls;
+                          }});
+
+    // is_check() for every piece on the board, as if it had just moved.
+    benchmarks.push_back({"Board::is_check", [&boards]() {
+                              size_t calls = 0;
+                              for (Board &board : boards)
+                              {
+                                  for (PieceRange side : {board.white(), board.black()})
+                                  {
+                                      for (const Piece *p : side)
+                                      {
+                                          sink = sink + board.is_check(p);
+                                          calls++;
+                                      }
+                                  }
+                              }
+                              return calls;
+                          }});
+
+    // Checking every legal move in every position as one batch, on the calling thread.
+    vector<MoveCheck> checks;
+    for (Board &board : boards)
+    {
+        for (const Move &m : board.legal_moves(board.turn()))
+        {
+            checks.push_back({&board, m});
+        }
+    }
+    MoveValidator validator(1);
+    vector<int> outcomes(checks.size());
+    benchmarks.push_back({"MoveValidator::validate", [&checks, &validator, &outcomes]() {
+                              validator.validate(checks.data(), checks.size(), outcomes.data());
+                              sink = sink + outcomes[0];
+                              return checks.size();
+                          }});
+
+    // Copying a board, which the search does for every position it visits. The copies are kept, so the compiler
+    // can't skip making them.
+    vector<Board> copies(boards.size());
+    benchmarks.push_back({"Board copy", [&boards, &copies]() {
+                              for (size_t i = 0; i < boards.size(); i++)
+                              {
+                                  copies[i] = boards[i];
+                                  sink = sink + copies[i].turn();
+                              }
+                              return boards.size();
+                          }});
+
+    cout << "Each benchmark is warmed up for " << WARMUP_MS << " ms, then timed over " << SAMPLES << " samples of about "
+         << SAMPLE_MS << " ms each, across " << boards.size() << " positions.\n\n"
+         << left << setw(24) << "benchmark" << right << setw(12) << "ns/op" << setw(10) << "+/-" << setw(14) << "allocs/op" << "\n";
+
+    for (const Benchmark &benchmark : benchmarks)
+    {
+        Measurement m = measure(benchmark);
+        cout << left << setw(24) << benchmark.name << right << fixed << setprecision(1) << setw(12) << m.median
+             << setw(9) << m.spread * 100 << "%" << setprecision(2) << setw(14) << m.allocs << endl;
+    }
+
+    return 0;
+}
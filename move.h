@@ -0,0 +1,78 @@
+#ifndef MOVE_H
+#define MOVE_H
+
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <utility>
+using namespace std;
+
+// A single move of a piece from one square to another.
+//
+// Like pieces, the coords of a square are dictated by [row][column], or [y][x].
+// Castling is written as the king's move, two squares toward the rook, and en passant as the pawn's diagonal move
+// onto the empty square behind the pawn it captures, so neither needs anything extra. Promotion does.
+struct Move
+{
+    pair<int, int> from; // Location of the square the piece is being moved from.
+    pair<int, int> to;   // Location of the square the piece is being moved to.
+    char promotion = 0;  // Name of the piece a pawn reaching the last row becomes: 'Q', 'R', 'B', or 'N'. 0 for any other move.
+};
+
+// Operator overloads for comparing two moves.
+inline bool operator==(const Move &lhs, const Move &rhs)
+{
+    return lhs.from == rhs.from && lhs.to == rhs.to && lhs.promotion == rhs.promotion;
+}
+
+inline bool operator!=(const Move &lhs, const Move &rhs)
+{
+    return !(lhs == rhs);
+}
+
+// Return the name of the square at a location, like "e4".
+inline string squareName(pair<int, int> location)
+{
+    return string(1, 'a' + location.second) + char('1' + location.first);
+}
+
+// Return a move in coordinate notation, like "e2e4", or "e7e8q" for a promotion.
+inline string moveName(Move m)
+{
+    string name = squareName(m.from) + squareName(m.to);
+    if (m.promotion)
+    {
+        name += char(tolower(m.promotion));
+    }
+    return name;
+}
+
+// Read the name of a square, like "e4", starting at the given position in the text. Return false if it isn't a square on the 8x8 board.
+inline bool parseSquare(const string &text, pair<int, int> &location, size_t start = 0)
+{
+    if (text.size() < start + 2 || text[start] < 'a' || text[start] > 'h' || text[start + 1] < '1' || text[start + 1] > '8')
+    {
+        return false;
+    }
+
+    location = {text[start + 1] - '1', text[start] - 'a'};
+    return true;
+}
+
+// Read a move in coordinate notation, like "e2e4", or "e7e8q" for a promotion. Return false if the text isn't a move on the 8x8 board.
+inline bool parseMove(const string &text, Move &m)
+{
+    m.promotion = 0;
+    if (text.size() == 5)
+    {
+        if (!strchr("qrbnQRBN", text[4]) || !text[4])
+        {
+            return false;
+        }
+        m.promotion = toupper(text[4]);
+    }
+
+    return (text.size() == 4 || text.size() == 5) && parseSquare(text, m.from, 0) && parseSquare(text, m.to, 2);
+}
+
+#endif // MOVE_H
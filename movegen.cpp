@@ -0,0 +1,74 @@
+#include "movegen.h"
+#include <new>
+using namespace std;
+
+// Bytes kept after every frame in the arena, saying how big it is and whether it has been freed, so the top of the
+// stack can be walked back down past frames that were freed out of order.
+struct FrameFooter
+{
+    size_t size; // Bytes taken up by the frame, including this footer.
+    bool freed;  // Whether or not the frame has been given back.
+};
+
+static const size_t FOOTER_SIZE = (sizeof(FrameFooter) + __STDCPP_DEFAULT_NEW_ALIGNMENT__ - 1) / __STDCPP_DEFAULT_NEW_ALIGNMENT__ * __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+/**
+ * Carves a frame off the top of the block. If the block is full, the frame comes from the heap instead.
+ *
+ * @param size Bytes the frame needs.
+ * @return The frame's memory.
+ */
+void *FrameArena::allocate(size_t size)
+{
+    size_t total = (size + ALIGN - 1) / ALIGN * ALIGN + FOOTER_SIZE;
+    if (total > SIZE - _top)
+    {
+        return ::operator new(size);
+    }
+
+    void *frame = _memory + _top;
+    _top += total;
+    *reinterpret_cast<FrameFooter *>(_memory + _top - FOOTER_SIZE) = {total, false};
+    return frame;
+}
+
+/**
+ * Gives back a frame. The top of the stack moves down past it, along with any frames below it that were already
+ * freed, unless a frame still in use sits above it.
+ *
+ * @param frame The frame's memory, as returned by allocate().
+ * @param size Bytes the frame was allocated with.
+ */
+void FrameArena::release(void *frame, size_t size)
+{
+    unsigned char *bytes = static_cast<unsigned char *>(frame);
+    if (bytes < _memory || bytes >= _memory + SIZE)
+    {
+        ::operator delete(frame);
+        return;
+    }
+
+    size_t total = (size + ALIGN - 1) / ALIGN * ALIGN + FOOTER_SIZE;
+    reinterpret_cast<FrameFooter *>(bytes + total - FOOTER_SIZE)->freed = true;
+
+    while (_top > 0)
+    {
+        FrameFooter *footer = reinterpret_cast<FrameFooter *>(_memory + _top - FOOTER_SIZE);
+        if (!footer->freed)
+        {
+            break;
+        }
+        _top -= footer->size;
+    }
+}
+
+/**
+ * Retrieves the calling thread's arena. Each thread gets its own, so allocating frames never needs a lock.
+ *
+ * @return The arena.
+ */
+FrameArena &FrameArena::local()
+{
+    static thread_local FrameArena arena;
+    return arena;
+}
@@ -0,0 +1,119 @@
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include "move.h"
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+using namespace std;
+
+// Memory for the frames of move generators, handed out from a block each thread keeps for itself.
+//
+// Generators are almost always destroyed in the reverse of the order they were created in, like the frames of the
+// functions calling them, so the block is used as a stack: a frame is carved off the top, and given back by moving
+// the top down again. A frame freed out of order is only marked as free, and the top moves past it once every frame
+// above it is freed too. Only if a thread somehow has more frames alive than fit in its block does a frame come from
+// the heap instead.
+class FrameArena
+{
+private:
+    static const size_t SIZE = 32 * 1024;                         // Bytes in the block.
+    static const size_t ALIGN = __STDCPP_DEFAULT_NEW_ALIGNMENT__; // Every frame starts on a multiple of this.
+
+    // Attributes.
+    alignas(ALIGN) unsigned char _memory[SIZE]; // The block frames are carved from.
+    size_t _top;                                // Bytes of the block in use, counting freed frames not yet given back.
+
+public:
+    // Constructor.
+    FrameArena() : _top(0) {}
+
+    void *allocate(size_t size);            // Carve a frame of the given size off the top of the block.
+    void release(void *frame, size_t size); // Give back a frame allocated by this arena.
+    size_t used() const { return _top; }    // Retrieve the number of bytes of the block in use.
+
+    static FrameArena &local(); // Retrieve the calling thread's arena.
+};
+
+// The legal moves of a position, worked out one at a time as they're asked for.
+//
+// It's a coroutine: every time the loop over it asks for another move, the generator picks up right where it left
+// off, so a caller that stops early, like one that only wants to know if there's any legal move at all, never pays
+// for the moves it didn't look at. Its frame comes from the thread's FrameArena rather than the heap.
+//
+// The board it came from must outlive it and be left alone while it's in use, and it must be used and destroyed on
+// the thread that created it.
+class MoveGenerator
+{
+public:
+    // What the compiler needs to run a function returning a MoveGenerator as a coroutine.
+    struct promise_type
+    {
+        Move current; // Move most recently yielded.
+
+        MoveGenerator get_return_object() { return MoveGenerator(coroutine_handle<promise_type>::from_promise(*this)); }
+        suspend_always initial_suspend() noexcept { return {}; }
+        suspend_always final_suspend() noexcept { return {}; }
+        suspend_always yield_value(const Move &m) noexcept
+        {
+            current = m;
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() { terminate(); }
+
+        static void *operator new(size_t size) { return FrameArena::local().allocate(size); }
+        static void operator delete(void *frame, size_t size) { FrameArena::local().release(frame, size); }
+    };
+
+    // Walks through the moves, resuming the generator for each new one.
+    class iterator
+    {
+    private:
+        coroutine_handle<promise_type> _handle; // The generator. Null once it has run out of moves.
+
+    public:
+        explicit iterator(coroutine_handle<promise_type> handle) : _handle(handle && !handle.done() ? handle : nullptr) {}
+
+        const Move &operator*() const { return _handle.promise().current; }
+        iterator &operator++()
+        {
+            _handle.resume();
+            if (_handle.done())
+            {
+                _handle = nullptr;
+            }
+            return *this;
+        }
+        bool operator==(const iterator &other) const { return _handle == other._handle; }
+        bool operator!=(const iterator &other) const { return _handle != other._handle; }
+    };
+
+    // Constructors and destructor. A generator can be moved but not copied.
+    explicit MoveGenerator(coroutine_handle<promise_type> handle) : _handle(handle) {}
+    MoveGenerator(MoveGenerator &&other) noexcept : _handle(other._handle) { other._handle = nullptr; }
+    MoveGenerator(const MoveGenerator &) = delete;
+    MoveGenerator &operator=(const MoveGenerator &) = delete;
+    ~MoveGenerator()
+    {
+        if (_handle)
+        {
+            _handle.destroy();
+        }
+    }
+
+    // Start generating moves. Should only be called once.
+    iterator begin()
+    {
+        _handle.resume();
+        return iterator(_handle);
+    }
+
+    iterator end() { return iterator(nullptr); } // Just past the last move.
+
+private:
+    // Attributes.
+    coroutine_handle<promise_type> _handle; // The coroutine generating the moves.
+};
+
+#endif // MOVEGEN_H
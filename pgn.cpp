@@ -0,0 +1,580 @@
+#include "pgn.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+/**
+ * Destructor for PGN files. Unmaps and closes the file, if one is open.
+ */
+PgnFile::~PgnFile()
+{
+    if (_data)
+    {
+        munmap(const_cast<char *>(_data), _size);
+    }
+
+    if (_fd >= 0)
+    {
+        close(_fd);
+    }
+}
+
+/**
+ * Maps a PGN file into memory. Pages are only read from disk as they're touched, so even huge files open instantly.
+ *
+ * @param path Path of the file to open.
+ * @return Whether or not the file could be opened.
+ */
+bool PgnFile::open(const string &path)
+{
+    struct stat info;
+
+    _fd = ::open(path.c_str(), O_RDONLY);
+    if (_fd < 0 || fstat(_fd, &info) < 0)
+    {
+        return false;
+    }
+
+    _size = info.st_size;
+    if (_size == 0)
+    {
+        return true;
+    }
+
+    void *data = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if (data == MAP_FAILED)
+    {
+        _size = 0;
+        return false;
+    }
+
+    // Games are read front to back, so let the kernel read ahead.
+    madvise(data, _size, MADV_SEQUENTIAL);
+    _data = static_cast<const char *>(data);
+    return true;
+}
+
+/**
+ * Finds the start of the first game at or after an offset.
+ *
+ * A game starts with a line of tags like [Event "..."]. Only the first tag of a game counts, so a tag line
+ * is a game start if the last line before it that isn't blank is something other than another tag.
+ *
+ * @param offset Byte offset to start looking from. If it's partway through a line, the search starts on the next line.
+ * @return Byte offset of the start of the game, or size() if there are no more games.
+ */
+size_t PgnFile::next_game(size_t offset) const
+{
+    size_t p = offset;
+
+    // Start at the beginning of a line.
+    if (p > 0 && p < _size && _data[p - 1] != '\n')
+    {
+        const char *newline = static_cast<const char *>(memchr(_data + p, '\n', _size - p));
+        p = newline ? newline - _data + 1 : _size;
+    }
+
+    while (p < _size)
+    {
+        if (_data[p] == '[')
+        {
+            // Walk back over blank space to the end of the previous line.
+            size_t q = p;
+            while (q > 0 && isspace(static_cast<unsigned char>(_data[q - 1])))
+            {
+                q--;
+            }
+
+            // Then walk back to its start.
+            while (q > 0 && _data[q - 1] != '\n')
+            {
+                q--;
+            }
+
+            if (q == p || _data[q] != '[')
+            {
+                return p;
+            }
+        }
+
+        const char *newline = static_cast<const char *>(memchr(_data + p, '\n', _size - p));
+        p = newline ? newline - _data + 1 : _size;
+    }
+
+    return _size;
+}
+
+/**
+ * Checks if a token of movetext is a game termination marker.
+ * @param token The token to check.
+ * @return Whether or not the token is "1-0", "0-1", "1/2-1/2", or "*".
+ */
+static bool isResult(const string &token)
+{
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+/**
+ * Works out which move a move written in standard algebraic notation, like "Nbxd7+", is talking about.
+ *
+ * The board only needs to be told where the piece is and where it's going, so the hard part is working out
+ * which piece the move is talking about. Usually only one piece of that type can reach the square. If more than
+ * one can, the one that can legally do so is the right one. The move isn't played.
+ *
+ * @param board The position the move is played in.
+ * @param san The move, without any check or annotation symbols.
+ * @param m Set to the move.
+ * @return GOOD if exactly one piece can make the move, BAD if none or several can.
+ */
+int parseSan(Board &board, const string &san, Move &m)
+{
+    // Castling is written as the king's move, two squares toward the rook.
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0")
+    {
+        int row = board.turn() == WHITE ? 0 : 7;
+        m = {{row, 4}, {row, san.size() == 3 ? 6 : 2}};
+        return GOOD;
+    }
+
+    // A promotion names the piece the pawn becomes after the square, usually following an equals sign.
+    size_t length = san.size();
+    char promotion = 0;
+    if (length > 2 && strchr("QRBN", san[length - 1]))
+    {
+        promotion = san[length - 1];
+        length -= san[length - 2] == '=' ? 2 : 1;
+    }
+
+    char name = strchr("KQRBN", san[0]) ? san[0] : PAWN; // Name of the piece being moved.
+
+    if (length < 2 || !checkMoveCoords(san[length - 2], san[length - 1]))
+    {
+        return BAD;
+    }
+
+    m.to = {san[length - 1] - '1', san[length - 2] - 'a'};
+
+    // Everything between the piece and the destination is either a capture marker or narrows down which piece is moving.
+    int from_col = -1;
+    int from_row = -1;
+    bool capture = false;
+    for (size_t i = name == PAWN ? 0 : 1; i < length - 2; i++)
+    {
+        if (san[i] >= 'a' && san[i] <= 'h')
+        {
+            from_col = san[i] - 'a';
+        }
+        else if (san[i] >= '1' && san[i] <= '8')
+        {
+            from_row = san[i] - '1';
+        }
+        else if (san[i] == 'x')
+        {
+            capture = true;
+        }
+        else
+        {
+            return BAD;
+        }
+    }
+
+    if (promotion && (name != PAWN || (m.to.first != 0 && m.to.first != 7)))
+    {
+        return BAD;
+    }
+
+    if (name == PAWN)
+    {
+        // A pawn reaching the last row that doesn't say what it becomes is a queen.
+        if (m.to.first == 0 || m.to.first == 7)
+        {
+            promotion = promotion ? promotion : QUEEN;
+        }
+
+        // A pawn that isn't capturing stays in its own column.
+        if (!capture)
+        {
+            from_col = m.to.second;
+        }
+    }
+
+    // Find every piece of the right type that could move to the square, ignoring everything else on the board.
+    vector<Move> candidates;
+    PieceRange pieces = board.pieces(board.turn(), name);
+    for (auto it = pieces.begin(); it != pieces.end(); ++it)
+    {
+        pair<int, int> location = (*it)->location();
+        if ((from_col >= 0 && location.second != from_col) || (from_row >= 0 && location.first != from_row))
+        {
+            continue;
+        }
+
+        vector<pair<int, int>> move_to_list = (*it)->moveCheck(m.to);
+        if (!move_to_list.empty() && move_to_list.back() == m.to)
+        {
+            candidates.push_back({location, m.to, promotion});
+        }
+    }
+
+    // If that isn't enough to tell the pieces apart, only one of them should be able to make the move legally.
+    if (candidates.size() > 1)
+    {
+        vector<Move> legal = board.legal_moves(board.turn());
+        candidates.erase(remove_if(candidates.begin(), candidates.end(), [&legal](const Move &c) {
+                             return find(legal.begin(), legal.end(), c) == legal.end();
+                         }),
+                         candidates.end());
+    }
+
+    if (candidates.size() != 1)
+    {
+        return BAD;
+    }
+
+    m = candidates.front();
+    return GOOD;
+}
+
+/**
+ * Replays a single move written in standard algebraic notation through the board's rules.
+ *
+ * @param board The board to play the move on.
+ * @param san The move to play, without any check or annotation symbols.
+ * @param m Set to the move that was played.
+ * @return Movement outcome code defined in piece.h.
+ */
+static int replayMove(Board &board, const string &san, Move &m)
+{
+    int found = parseSan(board, san, m);
+    return found == GOOD ? board.try_move(m).outcome : found;
+}
+
+/**
+ * Replays a single game from a PGN file, stopping at the first move that can't be replayed.
+ *
+ * Comments, variations, annotation glyphs, and move numbers are skipped over. If the game ends in checkmate
+ * or stalemate, the recorded result is checked against it.
+ *
+ * @param text Text of the game, starting at its first tag.
+ * @param length Length of the text in bytes.
+ * @param game Filled in with what happened. The offset is left as it is.
+ * @param moves If not NULL, every move that was replayed is added to it.
+ * @return Whether or not the whole game was replayed and its result matches.
+ */
+bool replayGame(const char *text, size_t length, PgnGame &game, vector<Move> *moves)
+{
+    Board board;
+
+    game.plies = 0;
+    game.status = PGN_OK;
+    game.result = "*";
+    game.detail.clear();
+    game.white.clear();
+    game.black.clear();
+    game.date.clear();
+    game.fen.clear();
+
+    int outcome = GOOD; // Outcome of the last move replayed.
+    size_t i = 0;
+
+    // Tags. Only the result and the starting position matter to the replay, but the players and date are kept too.
+    while (i < length)
+    {
+        while (i < length && isspace(static_cast<unsigned char>(text[i])))
+        {
+            i++;
+        }
+
+        if (i >= length || text[i] != '[')
+        {
+            break;
+        }
+
+        size_t end = i;
+        while (end < length && text[end] != '\n')
+        {
+            end++;
+        }
+
+        size_t open_quote = find(text + i, text + end, '"') - text;
+        size_t close_quote = find(text + min(open_quote + 1, end), text + end, '"') - text;
+        string name(text + i + 1, find(text + i + 1, text + end, ' '));
+        string value(text + min(open_quote + 1, end), text + close_quote);
+
+        if (name == "Result")
+        {
+            game.result = value;
+        }
+
+        else if (name == "White")
+        {
+            game.white = value;
+        }
+
+        else if (name == "Black")
+        {
+            game.black = value;
+        }
+
+        else if (name == "Date")
+        {
+            game.date = value;
+        }
+
+        else if (name == "FEN")
+        {
+            game.fen = value;
+            if (!board.set_fen(value))
+            {
+                game.status = PGN_UNSUPPORTED;
+                game.detail = value;
+                return false;
+            }
+        }
+
+        i = end;
+    }
+
+    // Movetext.
+    while (i < length)
+    {
+        char c = text[i];
+
+        if (isspace(static_cast<unsigned char>(c)))
+        {
+            i++;
+            continue;
+        }
+
+        // Comments, which either run to a closing brace or the end of the line.
+        if (c == '{' || c == ';')
+        {
+            const char *end = static_cast<const char *>(memchr(text + i, c == '{' ? '}' : '\n', length - i));
+            i = end ? end - text + 1 : length;
+            continue;
+        }
+
+        // Variations, which may have other variations nested inside them.
+        if (c == '(')
+        {
+            int depth = 0;
+            for (; i < length; i++)
+            {
+                if (text[i] == '{')
+                {
+                    const char *end = static_cast<const char *>(memchr(text + i, '}', length - i));
+                    i = end ? end - text : length - 1;
+                }
+                else if (text[i] == '(')
+                {
+                    depth++;
+                }
+                else if (text[i] == ')' && --depth == 0)
+                {
+                    break;
+                }
+            }
+
+            i++;
+            continue;
+        }
+
+        size_t start = i;
+        while (i < length && !isspace(static_cast<unsigned char>(text[i])) && !strchr("{};()", text[i]))
+        {
+            i++;
+        }
+
+        // Numeric annotation glyphs, like $1.
+        if (c == '$')
+        {
+            continue;
+        }
+
+        string token(text + start, i - start);
+
+        if (isResult(token))
+        {
+            game.result = token;
+            break;
+        }
+
+        // Move numbers, like "12." or "12...", which may be stuck to the front of the move.
+        size_t skip = token.find_first_not_of("0123456789");
+        if (skip != string::npos && token[skip] == '.' && skip > 0)
+        {
+            token.erase(0, token.find_first_not_of('.', skip));
+        }
+        else if (skip == string::npos)
+        {
+            token.clear();
+        }
+
+        // Check, checkmate, and annotation symbols, like "+", "#", and "!?".
+        token.erase(token.find_last_not_of("+#!?") + 1);
+
+        if (token.empty())
+        {
+            continue;
+        }
+
+        if (outcome == CHECKMATE || outcome == STALEMATE)
+        {
+            game.status = PGN_ILLEGAL;
+            game.detail = token;
+            return false;
+        }
+
+        Move m;
+        outcome = replayMove(board, token, m);
+
+        if (outcome == BAD)
+        {
+            game.status = PGN_ILLEGAL;
+            game.detail = token;
+            return false;
+        }
+
+        if (moves)
+        {
+            moves->push_back(m);
+        }
+
+        game.plies++;
+    }
+
+    // If the game ended on the board, the recorded result has to agree.
+    if (outcome == CHECKMATE || outcome == STALEMATE)
+    {
+        // The turn has already passed to the player who can't move.
+        string expected = outcome == STALEMATE ? "1/2-1/2" : board.turn() == BLACK ? "1-0" : "0-1";
+
+        if (game.result != expected)
+        {
+            game.status = PGN_MISMATCH;
+            game.detail = expected;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Replays every game in a PGN file and prints a report on them.
+ *
+ * The file is cut into slices, and each worker takes the games that start in the next slice it claims.
+ * Workers never share a board, and only touch their own tally, so nothing needs to be locked while replaying.
+ *
+ * @param path Path of the PGN file.
+ * @param threads Number of worker threads. If 0, one per core is used.
+ * @return 0 if every game replayed cleanly (or used a rule that isn't supported), 1 otherwise.
+ */
+int replayPgn(const string &path, int threads)
+{
+    // Counts kept by a single worker. Each is padded out to its own cache line, so workers don't slow each other down.
+    struct alignas(64) Tally
+    {
+        long long games;
+        long long plies;
+        long long statuses[4];
+        long long results[4];
+    };
+
+    PgnFile file;
+    if (!file.open(path))
+    {
+        cout << "Couldn't open " << path << "." << endl;
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+
+    // Slices are at most 1 MB, but small files are still cut finely enough to keep every worker busy.
+    size_t slice = min<size_t>(1 << 20, max<size_t>(1 << 16, file.size() / (pool.size() * 16)));
+    size_t count = (file.size() + slice - 1) / slice; // Number of slices.
+    vector<Tally> tallies(pool.size(), Tally());      // Counts kept by each worker.
+    vector<vector<PgnGame>> problems(count);          // Games that didn't replay cleanly, by slice.
+    vector<long long> games(count, 0);                // Number of games in each slice.
+
+    auto start = chrono::steady_clock::now();
+
+    pool.run(count, [&](size_t item, int worker) {
+        size_t end = min(file.size(), (item + 1) * slice);
+        Tally &tally = tallies[worker];
+        PgnGame game;
+
+        for (size_t offset = file.next_game(item * slice); offset < end;)
+        {
+            size_t next = file.next_game(offset + 1);
+
+            game.offset = offset;
+            replayGame(file.data() + offset, next - offset, game);
+
+            tally.games++;
+            tally.plies += game.plies;
+            tally.statuses[game.status]++;
+            tally.results[game.result == "1-0" ? 0 : game.result == "0-1" ? 1 : game.result == "1/2-1/2" ? 2 : 3]++;
+
+            // Starting positions that can't be set up are only counted.
+            if (game.status == PGN_ILLEGAL || game.status == PGN_MISMATCH)
+            {
+                game.number = games[item];
+                problems[item].push_back(game);
+            }
+
+            games[item]++;
+            offset = next;
+        }
+    });
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    Tally total = Tally();
+    for (auto it = tallies.begin(); it != tallies.end(); ++it)
+    {
+        total.games += it->games;
+        total.plies += it->plies;
+        for (int k = 0; k < 4; k++)
+        {
+            total.statuses[k] += it->statuses[k];
+            total.results[k] += it->results[k];
+        }
+    }
+
+    // Number the problem games by where they are in the whole file, rather than in their slice.
+    long long number = 0;
+    for (size_t item = 0; item < count; item++)
+    {
+        for (auto it = problems[item].begin(); it != problems[item].end(); ++it)
+        {
+            cout << "Game " << number + it->number + 1 << " (byte " << it->offset << "): ";
+            if (it->status == PGN_ILLEGAL)
+            {
+                cout << "illegal move " << it->detail << " after " << it->plies << " moves" << endl;
+            }
+            else
+            {
+                cout << "recorded result " << it->result << ", but the final position means " << it->detail << endl;
+            }
+        }
+
+        number += games[item];
+    }
+
+    cout << "Replayed " << total.games << " games (" << total.plies << " moves) in " << seconds << " s with "
+         << pool.size() << " threads: " << static_cast<long long>(total.plies / max(seconds, 1e-9)) << " moves/s.\n"
+         << "Results: 1-0: " << total.results[0] << ", 0-1: " << total.results[1]
+         << ", 1/2-1/2: " << total.results[2] << ", other: " << total.results[3] << ".\n"
+         << "Clean: " << total.statuses[PGN_OK] << ", unsupported positions: " << total.statuses[PGN_UNSUPPORTED]
+         << ", illegal moves: " << total.statuses[PGN_ILLEGAL] << ", result mismatches: " << total.statuses[PGN_MISMATCH] << "." << endl;
+
+    return total.statuses[PGN_ILLEGAL] || total.statuses[PGN_MISMATCH] ? 1 : 0;
+}
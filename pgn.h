@@ -0,0 +1,54 @@
+#ifndef PGN_H
+#define PGN_H
+
+#include "board.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+// Constants to represent the outcome of replaying a game from a PGN file.
+const int PGN_OK = 0;          // Every move was legal, and the result matches the final position.
+const int PGN_ILLEGAL = 1;     // A move couldn't be read, or isn't legal in the position it was played in.
+const int PGN_UNSUPPORTED = 2; // The game starts from a position, given by its FEN tag, that the board can't be set up in.
+const int PGN_MISMATCH = 3;    // Every move was legal, but the game ended in checkmate or stalemate and the result says otherwise.
+
+// What happened when a single game was replayed.
+struct PgnGame
+{
+    size_t offset;    // Byte offset of the game in the PGN file.
+    long long number; // Number of the game, counting from 0. Only filled in by whoever is walking through the file.
+    int plies;        // Number of moves that were replayed successfully.
+    int status;       // Outcome of the replay, from the PGN_ constants above.
+    string result;    // Result of the game as recorded in the file: "1-0", "0-1", "1/2-1/2", or "*".
+    string detail;    // The move that couldn't be replayed, or the result that was expected.
+    string white;     // Name of the white player, from the White tag.
+    string black;     // Name of the black player, from the Black tag.
+    string date;      // Date the game was played, from the Date tag, like "2019.02.22".
+    string fen;       // Starting position, from the FEN tag. Empty if the game starts from the usual position.
+};
+
+// A PGN file mapped into memory, so games can be read straight out of it without being copied.
+class PgnFile
+{
+private:
+    // Attributes.
+    int _fd;           // File descriptor of the open file. -1 if no file is open.
+    const char *_data; // Contents of the file.
+    size_t _size;      // Size of the file in bytes.
+
+public:
+    // Constructor and destructor.
+    PgnFile() : _fd(-1), _data(NULL), _size(0) {} // Default constructor.
+    ~PgnFile();                                    // Unmap and close the file.
+
+    bool open(const string &path);             // Map a file into memory. Return false if it can't be opened.
+    size_t next_game(size_t offset) const;     // Find the start of the first game at or after an offset. Return size() if there isn't one.
+    const char *data() const { return _data; } // Retrieve the contents of the file.
+    size_t size() const { return _size; }      // Retrieve the size of the file in bytes.
+};
+
+int parseSan(Board &board, const string &san, Move &m);                                     // Work out which move a move in standard algebraic notation is. Return GOOD if there's exactly one, BAD otherwise.
+bool replayGame(const char *text, size_t length, PgnGame &game, vector<Move> *moves = NULL); // Replay a single game through the rules. Return true if the replay succeeded.
+int replayPgn(const string &path, int threads);                                            // Replay every game in a PGN file across a pool of threads and report on them.
+
+#endif // PGN_H
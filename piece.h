@@ -17,6 +17,36 @@ const char BISHOP = 'B';
 const char KNIGHT = 'N';
 const char PAWN = 'P';
 
+// Names of every type of piece, and how many of each type a player starts the game with.
+const char PIECE_NAMES[] = "KQRBNP";
+const int PIECE_COUNTS[] = {1, 1, 2, 2, 2, 8};
+const int PIECE_TYPES = 6;
+
+/**
+ * Finds where a type of piece comes in PIECE_NAMES, for indexing tables kept for each type.
+ *
+ * @param name Name of the piece.
+ * @return Index of the name in PIECE_NAMES.
+ */
+inline int pieceType(char name)
+{
+    switch (name)
+    {
+    case KING:
+        return 0;
+    case QUEEN:
+        return 1;
+    case ROOK:
+        return 2;
+    case BISHOP:
+        return 3;
+    case KNIGHT:
+        return 4;
+    default:
+        return 5;
+    }
+}
+
 // Constants to represent potential movement outcomes.
 const int BAD = -1;      // The piece cannot be moved to this square.
 const int GOOD = 0;      // The piece can be moved to this square.
@@ -26,39 +56,45 @@ const int STALEMATE = 3; // The enemy player's king isn't vulnerable, but cannot
 
 // Functions.
 bool checkBounds(pair<int, int> location);
+inline char opponent(char color) { return color == WHITE ? BLACK : WHITE; } // Return the color of the other player.
 
 // It's important to remember the coords of a piece are dictated by [row][column], or [y][x].
+//
+// A piece is a plain value of four bytes, with no virtual functions and nothing pointing anywhere else, so copying
+// it is just copying its bytes. The way each type moves lives in the classes below, which are picked by name.
 class Piece
 {
 private:
     // Attributes
-    char _color;              // The color of the piece. Can be 'W' or 'B'.
-    char _name;               // The name of the piece. Can be 'K', 'Q', 'R', 'B', 'N', or 'P'
-    pair<int, int> _location; // Current location of the piece on the chess board. Bottom left is {0,0}, top right is {7,7}.
+    char _color;      // The color of the piece. Can be 'W' or 'B'.
+    char _name;       // The name of the piece. Can be 'K', 'Q', 'R', 'B', 'N', or 'P'
+    signed char _row; // Row the piece is on. Bottom is 0, top is 7.
+    signed char _col; // Column the piece is on. Left is 0, right is 7.
 
 public:
     // Constructors.
-    Piece() : _color(0), _name(0), _location({-1, -1}) {}                                                      // Default constructor.
-    Piece(char color, char name, pair<int, int> location) : _color(color), _name(name), _location(location) {} // Constructor for a specific piece.
+    Piece() : _color(0), _name(0), _row(-1), _col(-1) {}                                                                               // Default constructor.
+    Piece(char color, char name, pair<int, int> location) : _color(color), _name(name), _row(location.first), _col(location.second) {} // Constructor for a specific piece.
 
     // Getters
     char color() const { return _color; }                         // Return the color char of the piece.
     char name() const { return _name; }                           // Return the name char of the piece.
     string fullName() const { return string(1, _color) + _name; } // Return the color+name of the piece, giving it a unique name for that player's side.
-    pair<int, int> location() const { return _location; }         // Return the location pair of ints of the piece.
+    pair<int, int> location() const { return {_row, _col}; }      // Return the location pair of ints of the piece.
 
     // Setters
-    void move(pair<int, int> location) { _location = location; } // Sets the location of the piece to the argument's value.
+    void move(pair<int, int> location) { _row = location.first; _col = location.second; } // Sets the location of the piece to the argument's value.
 
-    virtual vector<pair<int, int>> moveCheck(pair<int, int> move_to) = 0; // Pure virtual function for returning the moves of a piece in a single direction.
-    virtual vector<vector<pair<int, int>>> allMoveCheck() = 0;            // Pure virtual function for returning all the moves of a piece.
+    vector<pair<int, int>> moveCheck(pair<int, int> move_to) const; // Return the squares between the piece and the square being moved to, if it can get there.
+    vector<vector<pair<int, int>>> allMoveCheck() const;            // Return every square the piece could move to, as one list for each direction.
 };
 
 class King : public Piece
 {
 public:
-    // Constructor.
+    // Constructors.
     King(char color, pair<int, int> location) : Piece(color, KING, location) {}
+    explicit King(const Piece &piece) : Piece(piece) {} // Look at a piece as a king, to use the way it moves.
 
     // Returns all squares between the king's current square and the square being moved to.
     vector<pair<int, int>> moveCheck(pair<int, int> move_to)
@@ -218,8 +254,9 @@ public:
 class Queen : public Piece
 {
 public:
-    // Constructor.
+    // Constructors.
     Queen(char color, pair<int, int> location) : Piece(color, QUEEN, location) {}
+    explicit Queen(const Piece &piece) : Piece(piece) {} // Look at a piece as a queen, to use the way it moves.
 
     // Returns all squares between the queen's current square and the square being moved to.
     vector<pair<int, int>> moveCheck(pair<int, int> move_to)
@@ -434,8 +471,9 @@ public:
 class Rook : public Piece
 {
 public:
-    // Constructor.
+    // Constructors.
     Rook(char color, pair<int, int> location) : Piece(color, ROOK, location) {}
+    explicit Rook(const Piece &piece) : Piece(piece) {} // Look at a piece as a rook, to use the way it moves.
 
     // Returns all squares between the rook's current square and the square being moved to.
     vector<pair<int, int>> moveCheck(pair<int, int> move_to)
@@ -554,8 +592,9 @@ public:
 class Bishop : public Piece
 {
 public:
-    // Constructor.
+    // Constructors.
     Bishop(char color, pair<int, int> location) : Piece(color, BISHOP, location) {}
+    explicit Bishop(const Piece &piece) : Piece(piece) {} // Look at a piece as a bishop, to use the way it moves.
 
     // Returns all squares between the bishop's current square and the square being moved to.
     vector<pair<int, int>> moveCheck(pair<int, int> move_to)
@@ -675,8 +714,9 @@ public:
 class Knight : public Piece
 {
 public:
-    // Constructor.
+    // Constructors.
     Knight(char color, pair<int, int> location) : Piece(color, KNIGHT, location) {}
+    explicit Knight(const Piece &piece) : Piece(piece) {} // Look at a piece as a knight, to use the way it moves.
 
     // Returns all squares between the knight's current square and the square being moved to.
     vector<pair<int, int>> moveCheck(pair<int, int> move_to)
@@ -752,70 +792,70 @@ public:
     }
 
     // Returns all possible squares the knight can move to.
+    //
+    // A knight jumps over anything in between, so every square is a direction of its own. Otherwise a piece on one
+    // of them would stop whoever is walking the list from looking at the rest.
     vector<vector<pair<int, int>>> allMoveCheck()
     {
         pair<int, int> to_add;
-        vector<pair<int, int>> move;
         vector<vector<pair<int, int>>> move_to_list;
 
         // Move up two, right one.
         to_add = {location().first + 2, location().second + 1};
         if (checkBounds(to_add))
         {
-            move.push_back(to_add);
+            move_to_list.push_back({to_add});
         }
 
         // Move right two, up one.
         to_add = {location().first + 1, location().second + 2};
         if (checkBounds(to_add))
         {
-            move.push_back(to_add);
+            move_to_list.push_back({to_add});
         }
 
         // Move right two, down one.
         to_add = {location().first - 1, location().second + 2};
         if (checkBounds(to_add))
         {
-            move.push_back(to_add);
+            move_to_list.push_back({to_add});
         }
 
         // Move down two, right one.
         to_add = {location().first - 2, location().second + 1};
         if (checkBounds(to_add))
         {
-            move.push_back(to_add);
+            move_to_list.push_back({to_add});
         }
 
         // Move down two, left one.
         to_add = {location().first - 2, location().second - 1};
         if (checkBounds(to_add))
         {
-            move.push_back(to_add);
+            move_to_list.push_back({to_add});
         }
 
         // Move left two, down one.
         to_add = {location().first - 1, location().second - 2};
         if (checkBounds(to_add))
         {
-            move.push_back(to_add);
+            move_to_list.push_back({to_add});
         }
 
         // Move left two, up one.
         to_add = {location().first + 1, location().second - 2};
         if (checkBounds(to_add))
         {
-            move.push_back(to_add);
+            move_to_list.push_back({to_add});
         }
 
         // Move up two, left one.
         to_add = {location().first + 2, location().second - 1};
         if (checkBounds(to_add))
         {
-            move.push_back(to_add);
+            move_to_list.push_back({to_add});
         }
 
-        move_to_list.push_back(move);
-
         return move_to_list;
     }
 };
@@ -823,8 +863,9 @@ public:
 class Pawn : public Piece
 {
 public:
-    // Constructor.
+    // Constructors.
     Pawn(char color, pair<int, int> location) : Piece(color, PAWN, location) {}
+    explicit Pawn(const Piece &piece) : Piece(piece) {} // Look at a piece as a pawn, to use the way it moves.
 
     // Returns all squares between the pawn's current square and the square being moved to.
     vector<pair<int, int>> moveCheck(pair<int, int> move_to)
@@ -1011,6 +1052,46 @@ inline bool operator==(const Piece *lhs, const Piece &rhs)
     return lhs->fullName() == rhs.fullName() && lhs->location() == rhs.location();
 }
 
+// Returns all squares between the piece's current square and the square being moved to, using the way its type moves.
+inline vector<pair<int, int>> Piece::moveCheck(pair<int, int> move_to) const
+{
+    switch (_name)
+    {
+    case KING:
+        return King(*this).moveCheck(move_to);
+    case QUEEN:
+        return Queen(*this).moveCheck(move_to);
+    case ROOK:
+        return Rook(*this).moveCheck(move_to);
+    case BISHOP:
+        return Bishop(*this).moveCheck(move_to);
+    case KNIGHT:
+        return Knight(*this).moveCheck(move_to);
+    default:
+        return Pawn(*this).moveCheck(move_to);
+    }
+}
+
+// Returns every square the piece could move to, one list for each direction, using the way its type moves.
+inline vector<vector<pair<int, int>>> Piece::allMoveCheck() const
+{
+    switch (_name)
+    {
+    case KING:
+        return King(*this).allMoveCheck();
+    case QUEEN:
+        return Queen(*this).allMoveCheck();
+    case ROOK:
+        return Rook(*this).allMoveCheck();
+    case BISHOP:
+        return Bishop(*this).allMoveCheck();
+    case KNIGHT:
+        return Knight(*this).allMoveCheck();
+    default:
+        return Pawn(*this).allMoveCheck();
+    }
+}
+
 // Return true if location is within 8x8 grid of chess board.
 inline bool checkBounds(pair<int, int> location)
 {
@@ -0,0 +1,397 @@
+#include "positions.h"
+#include "archive.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+// Number of games each worker claims at a time when building an index.
+const uint64_t INDEX_BATCH = 64;
+
+/**
+ * Orders entries by hash, then game, then ply.
+ */
+static bool operator<(const PositionEntry &lhs, const PositionEntry &rhs)
+{
+    if (lhs.hash != rhs.hash)
+    {
+        return lhs.hash < rhs.hash;
+    }
+
+    return lhs.game != rhs.game ? lhs.game < rhs.game : lhs.ply < rhs.ply;
+}
+
+/**
+ * Destructor for position indexes. Unmaps and closes the file, if one is open.
+ */
+PositionIndex::~PositionIndex()
+{
+    if (_data)
+    {
+        munmap(const_cast<uint8_t *>(_data), _size);
+    }
+
+    if (_fd >= 0)
+    {
+        close(_fd);
+    }
+}
+
+/**
+ * Maps a position index into memory.
+ * Lookups jump around the file, so the kernel is told not to bother reading ahead.
+ *
+ * @param path Path of the file to open.
+ * @return Whether or not the file could be opened and looks like an index.
+ */
+bool PositionIndex::open(const string &path)
+{
+    struct stat info;
+
+    _fd = ::open(path.c_str(), O_RDONLY);
+    if (_fd < 0 || fstat(_fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(PositionIndexHeader))
+    {
+        return false;
+    }
+
+    _size = info.st_size;
+    void *data = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if (data == MAP_FAILED)
+    {
+        _size = 0;
+        return false;
+    }
+
+    _data = static_cast<const uint8_t *>(data);
+    madvise(data, _size, MADV_RANDOM);
+
+    const PositionIndexHeader *header = reinterpret_cast<const PositionIndexHeader *>(_data);
+    if (memcmp(header->magic, "ACPI", 4) != 0 || header->version != POSITION_INDEX_VERSION ||
+        header->entries > (_size - sizeof(PositionIndexHeader)) / sizeof(PositionEntry))
+    {
+        return false;
+    }
+
+    _entries = reinterpret_cast<const PositionEntry *>(_data + sizeof(PositionIndexHeader));
+    _count = header->entries;
+    return true;
+}
+
+/**
+ * Finds the first entry with a hash at least as big as the given one.
+ *
+ * Each step guesses where the hash should be from how far it is between the hashes at either end of the range
+ * still being searched. A bad guess can only shrink the range a little, so every other step halves it instead,
+ * which keeps the worst case as good as a binary search. The last few entries are left to a plain binary search.
+ *
+ * @param hash The hash to look for.
+ * @return The first entry with a hash at least as big. end() if there isn't one.
+ */
+const PositionEntry *PositionIndex::lower_bound(uint64_t hash) const
+{
+    // The answer is always somewhere from lo to hi, inclusive.
+    uint64_t lo = 0;
+    uint64_t hi = _count;
+
+    for (int step = 0; hi - lo > 32; step++)
+    {
+        uint64_t first = _entries[lo].hash;
+        uint64_t last = _entries[hi - 1].hash;
+
+        if (hash <= first)
+        {
+            return _entries + lo;
+        }
+
+        if (hash > last)
+        {
+            return _entries + hi;
+        }
+
+        uint64_t guess = step % 2 ? lo + (hi - lo) / 2 : lo + static_cast<uint64_t>(static_cast<long double>(hash - first) / (last - first) * (hi - 1 - lo));
+
+        if (_entries[guess].hash < hash)
+        {
+            lo = guess + 1;
+        }
+        else
+        {
+            hi = guess;
+        }
+    }
+
+    return std::lower_bound(_entries + lo, _entries + hi, hash, [](const PositionEntry &entry, uint64_t h) { return entry.hash < h; });
+}
+
+/**
+ * Finds every entry with the given hash.
+ * @param hash The hash to look for.
+ * @return The first entry with the hash, and the entry past the last one. Both are the same if there are none.
+ */
+pair<const PositionEntry *, const PositionEntry *> PositionIndex::find(uint64_t hash) const
+{
+    const PositionEntry *first = lower_bound(hash);
+    const PositionEntry *last = first;
+
+    // Most positions are only reached a few times, so look just past the first one before searching properly.
+    while (last != end() && last - first < 8 && last->hash == hash)
+    {
+        last++;
+    }
+
+    if (last != end() && last->hash == hash)
+    {
+        last = hash == UINT64_MAX ? end() : lower_bound(hash + 1);
+    }
+
+    return {first, last};
+}
+
+/**
+ * Replays every game in an archive and records every position reached into a position index.
+ *
+ * Each worker collects the entries for the games it replays and sorts them on its own. The sorted lists are then
+ * merged together as they're written out, so the entries never need to be gathered into one big list.
+ *
+ * @param archive_path Path of the archive to read.
+ * @param index_path Path of the index to write.
+ * @param threads Number of worker threads. If 0, one per core is used.
+ * @return 0 if the index was written, 1 otherwise.
+ */
+int buildPositionIndex(const string &archive_path, const string &index_path, int threads)
+{
+    GameArchive archive;
+    if (!archive.open(archive_path))
+    {
+        cout << "Couldn't open " << archive_path << ", or it isn't an archive." << endl;
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    vector<vector<PositionEntry>> entries(pool.size()); // Entries collected by each worker.
+    vector<vector<Move>> scratch(pool.size());          // Legal move buffer for each worker.
+    vector<long long> failures(pool.size(), 0);         // Number of games each worker couldn't decode.
+    uint64_t games = archive.games();
+
+    auto start = chrono::steady_clock::now();
+
+    pool.run((games + INDEX_BATCH - 1) / INDEX_BATCH, [&](size_t item, int worker) {
+        for (uint64_t number = item * INDEX_BATCH; number < min(games, (item + 1) * INDEX_BATCH); number++)
+        {
+            const GameRecord *record = archive.game(number);
+            Board board;
+            size_t size = entries[worker].size();
+
+            for (int ply = 0; record && ply <= record->plies; ply++)
+            {
+                Move m;
+                if (ply < record->plies && !archive.decode(record, ply, board, scratch[worker], m))
+                {
+                    record = NULL;
+                    break;
+                }
+
+                PositionEntry entry = {board.hash(), static_cast<uint32_t>(number), static_cast<uint16_t>(ply), ply < record->plies ? packMove(m) : NO_NEXT_MOVE};
+                entries[worker].push_back(entry);
+
+                if (ply < record->plies)
+                {
+                    board.apply(m);
+                }
+            }
+
+            // Leave out every position of a game that couldn't be decoded all the way through.
+            if (!record)
+            {
+                entries[worker].resize(size);
+                failures[worker]++;
+            }
+        }
+    });
+
+    pool.run(entries.size(), [&](size_t item, int) { sort(entries[item].begin(), entries[item].end()); });
+
+    ofstream out(index_path, ios::binary | ios::trunc);
+    if (!out)
+    {
+        cout << "Couldn't create " << index_path << "." << endl;
+        return 1;
+    }
+
+    PositionIndexHeader header = {{'A', 'C', 'P', 'I'}, POSITION_INDEX_VERSION, 0, games};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    // Merge the workers' lists, always writing whichever list's next entry comes first.
+    typedef pair<const PositionEntry *, const PositionEntry *> Range;
+    auto later = [](const Range &a, const Range &b) { return *b.first < *a.first; };
+    priority_queue<Range, vector<Range>, decltype(later)> heads(later);
+
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+    {
+        if (!it->empty())
+        {
+            heads.push({it->data(), it->data() + it->size()});
+        }
+    }
+
+    vector<PositionEntry> buffer; // Entries waiting to be written, so they go out in big writes.
+    buffer.reserve(1 << 16);
+
+    while (!heads.empty())
+    {
+        Range range = heads.top();
+        heads.pop();
+
+        buffer.push_back(*range.first);
+        header.entries++;
+
+        if (++range.first != range.second)
+        {
+            heads.push(range);
+        }
+
+        if (buffer.size() == buffer.capacity() || heads.empty())
+        {
+            out.write(reinterpret_cast<const char *>(buffer.data()), buffer.size() * sizeof(PositionEntry));
+            buffer.clear();
+        }
+    }
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.close();
+
+    if (!out)
+    {
+        cout << "Couldn't write " << index_path << "." << endl;
+        return 1;
+    }
+
+    long long total_failures = 0;
+    for (auto it = failures.begin(); it != failures.end(); ++it)
+    {
+        total_failures += *it;
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Indexed " << header.entries << " positions from " << games << " games in " << seconds << " s with " << pool.size()
+         << " threads. Left out " << total_failures << " games that couldn't be decoded." << endl;
+
+    return 0;
+}
+
+/**
+ * Formats a date stored as YYYYMMDD the way PGN does, like "2019.02.22", with "??" for any part that isn't known.
+ * @param date The date to format.
+ * @return The formatted date.
+ */
+static string formatDate(uint32_t date)
+{
+    ostringstream out;
+    out << setfill('0');
+
+    if (date / 10000)
+    {
+        out << setw(4) << date / 10000;
+    }
+    else
+    {
+        out << "????";
+    }
+
+    for (uint32_t part : {date / 100 % 100, date % 100})
+    {
+        out << '.';
+        if (part)
+        {
+            out << setw(2) << part;
+        }
+        else
+        {
+            out << "??";
+        }
+    }
+
+    return out.str();
+}
+
+/**
+ * Looks a position up in an index, and prints every move that was played from it along with the first few games
+ * that reached it.
+ *
+ * @param archive_path Path of the archive the index was built from. Only used to name the players.
+ * @param index_path Path of the index.
+ * @param fen FEN string of the position to look up.
+ * @return 0 if the lookup could be made, 1 otherwise.
+ */
+int lookupPosition(const string &archive_path, const string &index_path, const string &fen)
+{
+    GameArchive archive;
+    PositionIndex index;
+    Board board;
+
+    if (!archive.open(archive_path) || !index.open(index_path))
+    {
+        cout << "Couldn't open " << archive_path << " and " << index_path << "." << endl;
+        return 1;
+    }
+
+    if (!board.set_fen(fen))
+    {
+        cout << "Invalid FEN: " << fen << endl;
+        return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    pair<const PositionEntry *, const PositionEntry *> found = index.find(board.hash());
+    double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+
+    cout << "Reached " << found.second - found.first << " times, out of " << index.size() << " positions (lookup took "
+         << micros << " us)." << endl;
+
+    // How often each move was played from the position.
+    map<uint16_t, long long> next;
+    for (const PositionEntry *it = found.first; it != found.second; ++it)
+    {
+        next[it->next]++;
+    }
+
+    vector<pair<long long, uint16_t>> ranked;
+    for (auto it = next.begin(); it != next.end(); ++it)
+    {
+        ranked.push_back({it->second, it->first});
+    }
+    sort(ranked.rbegin(), ranked.rend());
+
+    for (auto it = ranked.begin(); it != ranked.end(); ++it)
+    {
+        cout << "  " << (it->second == NO_NEXT_MOVE ? "(game over)" : moveName(unpackMove(it->second))) << ": " << it->first << endl;
+    }
+
+    const PositionEntry *last = found.first + min<ptrdiff_t>(10, found.second - found.first);
+    for (const PositionEntry *it = found.first; it != last; ++it)
+    {
+        const GameRecord *record = archive.game(it->game);
+        if (!record)
+        {
+            continue;
+        }
+
+        cout << "Game " << it->game + 1 << " (" << archive.player(record->white) << " vs " << archive.player(record->black)
+             << ", " << formatDate(record->date) << "), after " << it->ply << " moves: "
+             << (it->next == NO_NEXT_MOVE ? "game over" : moveName(unpackMove(it->next))) << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+#ifndef POSITIONS_H
+#define POSITIONS_H
+
+#include "board.h"
+#include <cstdint>
+#include <string>
+using namespace std;
+
+// Next move of a position that was the last one of its game.
+const uint16_t NO_NEXT_MOVE = 0xffff;
+
+// Version of the position index format. Bumped whenever Board::hash() changes, since an index built with the old
+// hashes can't be searched with the new ones.
+const uint32_t POSITION_INDEX_VERSION = 2;
+
+// Start of every position index file.
+struct PositionIndexHeader
+{
+    char magic[4];    // Always "ACPI".
+    uint32_t version; // Version of the format. Always POSITION_INDEX_VERSION.
+    uint64_t entries; // Number of entries following the header.
+    uint64_t games;   // Number of games in the archive the index was built from.
+};
+
+// One position reached in one game. Entries are sorted by hash, then game, then ply.
+struct PositionEntry
+{
+    uint64_t hash; // Board::hash() of the position.
+    uint32_t game; // Number of the game in the archive, counting from 0.
+    uint16_t ply;  // Number of moves played in the game before the position was reached.
+    uint16_t next; // Move played from the position, packed by packMove(). NO_NEXT_MOVE if the game ended there.
+};
+
+// A position index mapped into memory, for finding every game that reached a position.
+//
+// Position hashes are spread evenly over all 64 bits, so the place a hash should be in the sorted entries can be
+// guessed from its value alone (interpolation search). That takes a handful of steps even with hundreds of millions
+// of entries, and so only touches a handful of pages of the file.
+class PositionIndex
+{
+private:
+    // Attributes.
+    int _fd;                       // File descriptor of the open file. -1 if no file is open.
+    const uint8_t *_data;          // Contents of the file.
+    size_t _size;                  // Size of the file in bytes.
+    const PositionEntry *_entries; // Every entry, sorted.
+    uint64_t _count;               // Number of entries.
+
+public:
+    // Constructor and destructor.
+    PositionIndex() : _fd(-1), _data(NULL), _size(0), _entries(NULL), _count(0) {} // Default constructor.
+    ~PositionIndex();                                                               // Unmap and close the file.
+
+    bool open(const string &path);                                                // Map an index into memory. Return false if it can't be opened or isn't an index.
+    uint64_t size() const { return _count; }                                      // Retrieve the number of entries.
+    const PositionEntry *begin() const { return _entries; }                       // Retrieve the first entry.
+    const PositionEntry *end() const { return _entries + _count; }                // Retrieve the entry past the last one.
+    const PositionEntry *lower_bound(uint64_t hash) const;                        // Find the first entry with a hash at least as big as the given one.
+    pair<const PositionEntry *, const PositionEntry *> find(uint64_t hash) const; // Find every entry with the given hash.
+};
+
+int buildPositionIndex(const string &archive_path, const string &index_path, int threads);   // Record every position of every game in an archive into an index.
+int lookupPosition(const string &archive_path, const string &index_path, const string &fen); // Report every game that reached a position, and what was played next.
+
+#endif // POSITIONS_H
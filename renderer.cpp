@@ -0,0 +1,120 @@
+#include "renderer.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <sys/ioctl.h>
+#include <unistd.h>
+using namespace std;
+
+// First terminal row underneath the 26 rows taken up by Board::print_board(), counting from 1. Everything else is printed from here down.
+const int PROMPT_ROW = 27;
+
+/**
+ * Default constructor for the renderer.
+ * ANSI escape codes are only used if the output is a terminal, it isn't a dumb one, and it's tall enough to hold
+ * the board with some room to spare underneath.
+ */
+Renderer::Renderer() : _ansi(false), _drawn(false)
+{
+    const char *term = getenv("TERM");
+    struct winsize size;
+
+    if (isatty(STDOUT_FILENO) && term && strcmp(term, "dumb") != 0 &&
+        ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row >= PROMPT_ROW + 4)
+    {
+        _ansi = true;
+    }
+
+    memset(_shown, ' ', sizeof(_shown));
+}
+
+/**
+ * Destructor for the renderer.
+ * Lets text scroll over the whole screen again, and clears it so whatever comes next starts at the top.
+ */
+Renderer::~Renderer()
+{
+    if (_ansi && _drawn)
+    {
+        cout << "\x1b[r\x1b[2J\x1b[H" << flush;
+    }
+}
+
+/**
+ * Draws the board, and clears the space underneath it for whatever gets printed next.
+ *
+ * The first time around, the whole board is drawn at the top of the screen, and the rows below it are set up
+ * to scroll on their own so the board never moves. Every time after that, only the squares whose contents
+ * have changed are drawn over, by moving the cursor straight to them.
+ *
+ * @param board The board to draw.
+ */
+void Renderer::draw(const Board &board)
+{
+    if (!_ansi)
+    {
+        board.print_board(cout);
+        return;
+    }
+
+    _frame.clear();
+
+    if (!_drawn)
+    {
+        ostringstream full;
+        board.print_board(full);
+
+        // Clear the screen, draw the board at the top, and only let the rows underneath it scroll.
+        _frame += "\x1b[r\x1b[2J\x1b[H";
+        _frame += full.str();
+        _frame += "\x1b[" + to_string(PROMPT_ROW) + "r";
+    }
+
+    for (int r = 0; r < board.rows(); r++)
+    {
+        for (int c = 0; c < board.columns(); c++)
+        {
+            const Square &square = board.square({r, c});
+            char shown[2] = {' ', ' '};
+
+            if (square.occupied())
+            {
+                shown[0] = square.piece()->color();
+                shown[1] = square.piece()->name();
+            }
+
+            if (_drawn && memcmp(shown, _shown[r][c], 2) == 0)
+            {
+                continue;
+            }
+
+            memcpy(_shown[r][c], shown, 2);
+
+            // Squares are drawn 3 rows tall and 5 columns wide, with the piece's name on their middle row.
+            if (_drawn)
+            {
+                _frame += "\x1b[" + to_string(3 + (7 - r) * 3) + ";" + to_string(4 + c * 5) + "H";
+                _frame.append(shown, 2);
+            }
+        }
+    }
+
+    // Park the cursor underneath the board and clear whatever was printed there last time.
+    _frame += "\x1b[" + to_string(PROMPT_ROW) + ";1H\x1b[J";
+    _drawn = true;
+
+    // Anything still sitting in cout's buffer belongs before this frame.
+    cout.flush();
+
+    for (size_t written = 0; written < _frame.size();)
+    {
+        ssize_t n = write(STDOUT_FILENO, _frame.data() + written, _frame.size() - written);
+        if (n <= 0)
+        {
+            break;
+        }
+
+        written += n;
+    }
+}
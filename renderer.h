@@ -0,0 +1,33 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include "board.h"
+#include <string>
+using namespace std;
+
+// Draws the board to the terminal.
+//
+// On terminals that understand ANSI escape codes, the board is drawn once at the top of the screen and kept there.
+// After that, only the squares that have changed are redrawn, and each frame goes out in a single write().
+// Everything else the game prints scrolls by underneath the board. On dumb terminals, or when the output isn't
+// a terminal at all, the whole board is printed every time instead.
+class Renderer
+{
+private:
+    // Attributes.
+    bool _ansi;           // True if the terminal understands ANSI escape codes.
+    bool _drawn;          // True once the whole board has been drawn, so only changes need to be drawn from then on.
+    char _shown[8][8][2]; // Color and name of the piece currently shown on each square. Spaces if the square is shown empty.
+    string _frame;        // Escape codes and text for the frame being built. Kept around so its memory can be reused.
+
+public:
+    // Constructor and destructor.
+    Renderer();  // Default constructor. Works out whether the terminal understands ANSI escape codes.
+    ~Renderer(); // Gives the whole screen back to the normal flow of text.
+
+    bool ansi() const { return _ansi; } // Retrieve whether the terminal understands ANSI escape codes.
+
+    void draw(const Board &board); // Draw the board and clear the space underneath it for the next prompt.
+};
+
+#endif // RENDERER_H
@@ -0,0 +1,70 @@
+#include "script.h"
+#include "board.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+using namespace std;
+
+/**
+ * Replays a transcript of commands through the local two-player game, exactly as if they'd been typed in, but
+ * without drawing the board or waiting for ENTER. Whenever a game ends and there are commands left, a new game is
+ * started on a fresh board. Once the commands run out, the board and state of the last game are printed.
+ *
+ * @param path Path of the file of commands, one per line.
+ * @param quiet If true, the game's messages are thrown away, and only the final summary is printed.
+ * @return 0 once the script has been played, 1 if it can't be read.
+ */
+int runScript(const string &path, bool quiet)
+{
+    ifstream file(path);
+    if (!file)
+    {
+        cout << "Couldn't open " << path << "." << endl;
+        return 1;
+    }
+
+    // The whole script is read up front, so the time measured is all spent in the game.
+    stringstream in;
+    in << file.rdbuf();
+
+    ostream discard(NULL); // Stream with nowhere to write to. Everything written to it is dropped.
+    ostream &out = quiet ? discard : cout;
+    Board board;
+    long long finished = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (;;)
+    {
+        board.play_human(in, out, false);
+
+        // The commands ran out partway through this game.
+        if (!in)
+        {
+            break;
+        }
+
+        finished++;
+
+        // Skipping blank lines before starting another game means a script can end with a finished game and still
+        // have it be the one that's printed at the end.
+        in >> ws;
+        if (in.eof())
+        {
+            break;
+        }
+
+        board = Board();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "\nFinal position:\n";
+    board.print_board(cout);
+    board.print_active(cout);
+    board.print_captured(cout);
+    cout << "\nFEN: " << board.to_fen() << "\n"
+         << "Games finished: " << finished << (in ? "" : ", and the last one was still being played when the script ran out") << "\n"
+         << "Time: " << seconds * 1000 << " ms (" << (seconds > 0 ? finished / seconds : 0) << " games per second)" << endl;
+
+    return 0;
+}
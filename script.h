@@ -0,0 +1,9 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <string>
+using namespace std;
+
+int runScript(const string &path, bool quiet); // Play the commands in a file through the local two-player game, one game after another, and report on them.
+
+#endif // SCRIPT_H
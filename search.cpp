@@ -0,0 +1,295 @@
+#include "search.h"
+#include "trace.h"
+#include <algorithm>
+using namespace std;
+
+/**
+ * Returns the material value of a piece.
+ * The king is priceless, but it can never be captured, so it isn't worth anything here.
+ *
+ * @param name Name of the piece. Can be 'K', 'Q', 'R', 'B', 'N', or 'P'.
+ * @return Value of the piece in centipawns.
+ */
+int pieceValue(char name)
+{
+    switch (name)
+    {
+    case QUEEN:
+        return 900;
+    case ROOK:
+        return 500;
+    case BISHOP:
+        return 330;
+    case KNIGHT:
+        return 320;
+    case PAWN:
+        return 100;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Returns a small bonus for a piece standing on a good square.
+ * Pawns are rewarded for advancing, and knights, bishops, and queens for staying near the center.
+ *
+ * @param piece The piece being scored.
+ * @return Bonus for the piece's location in centipawns.
+ */
+static int locationBonus(const Piece *piece)
+{
+    pair<int, int> location = piece->location();
+    int advance = piece->color() == WHITE ? location.first - 1 : 6 - location.first;        // Rows a pawn has moved up the board.
+    int center = 6 - abs(2 * location.first - 7) / 2 - abs(2 * location.second - 7) / 2; // 6 in the center, 0 in the corners.
+
+    switch (piece->name())
+    {
+    case PAWN:
+        return advance * 5;
+    case KNIGHT:
+    case BISHOP:
+        return center * 4;
+    case QUEEN:
+        return center * 2;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Scores a position by counting material and rewarding pieces on good squares.
+ *
+ * @param board The board being scored.
+ * @param color Color of the player the score is for.
+ * @return Score of the position in centipawns. Positive if the player is ahead.
+ */
+int evaluate(const Board &board, char color)
+{
+    int score = 0;
+
+    for (auto it = board.white().begin(); it != board.white().end(); ++it)
+    {
+        score += pieceValue((*it)->name()) + locationBonus(*it);
+    }
+
+    for (auto it = board.black().begin(); it != board.black().end(); ++it)
+    {
+        score -= pieceValue((*it)->name()) + locationBonus(*it);
+    }
+
+    return color == WHITE ? score : -score;
+}
+
+/**
+ * Orders moves so the most promising are searched first, which lets alpha-beta skip more of the rest.
+ * Captures of valuable pieces by cheap pieces come first, and quiet moves keep their original order.
+ *
+ * @param board The board the moves are made on.
+ * @param moves The moves to order.
+ */
+static void orderMoves(const Board &board, vector<Move> &moves)
+{
+    auto gain = [&board](const Move &m) {
+        const Square &to = board.square(m.to);
+        if (!to.occupied())
+        {
+            return 0;
+        }
+
+        return 10 * pieceValue(to.piece()->name()) - pieceValue(board.square(m.from).piece()->name()) + 1;
+    };
+
+    stable_sort(moves.begin(), moves.end(), [&gain](const Move &a, const Move &b) { return gain(a) > gain(b); });
+}
+
+/**
+ * Checks if the search has been told to stop from another thread, or if it has used up its time.
+ * Once this returns true, it keeps returning true until the search is over.
+ *
+ * @return Whether or not the search should stop.
+ */
+bool Search::should_stop()
+{
+    if (_stopped)
+    {
+        return true;
+    }
+
+    if (_limits.stop && _limits.stop->load(memory_order_relaxed))
+    {
+        _stopped = true;
+    }
+
+    else if (_limits.movetime > 0 && chrono::steady_clock::now() - _start >= chrono::milliseconds(_limits.movetime))
+    {
+        _stopped = true;
+    }
+
+    return _stopped;
+}
+
+/**
+ * Scores a position by trying every move, and every reply to those moves, down to a fixed depth.
+ * Lines the opponent would never allow are cut off as soon as they're found (alpha-beta pruning).
+ *
+ * @param board The board being searched. Each move is tried on a copy of it.
+ * @param color Color of the player to move.
+ * @param depth Number of moves left to look ahead.
+ * @param ply Number of moves made since the start of the search.
+ * @param alpha Score the player to move is already guaranteed.
+ * @param beta Score the opponent is already guaranteed.
+ * @return Score of the position from the point of view of the player to move.
+ */
+int Search::negamax(Board &board, char color, int depth, int ply, int alpha, int beta)
+{
+    _nodes++;
+
+    // Going back to a position that was already reached is a draw. A player who could do better wouldn't allow it,
+    // so the first repetition is scored as one, without waiting for the third.
+    uint64_t hash = board.hash();
+    if (_history.repetitions(hash, board.halfmove_clock()) > 0)
+    {
+        return 0;
+    }
+
+    // So is going fifty moves without a capture or a pawn move, unless the last of them was checkmate.
+    if (board.halfmove_clock() >= FIFTY_MOVE_PLIES && !(board.in_check(color) && !board.has_legal_move()))
+    {
+        return 0;
+    }
+
+    if (depth == 0)
+    {
+        return evaluate(board, color);
+    }
+
+    vector<Move> &moves = _moves[ply];
+    board.legal_moves(color, moves);
+
+    // The player can't move. Either they're in checkmate, or it's a stalemate and nobody wins.
+    if (moves.empty())
+    {
+        return board.in_check(color) ? -MATE + ply : 0;
+    }
+
+    orderMoves(board, moves);
+    _history.push(hash);
+
+    for (auto it = moves.begin(); it != moves.end(); ++it)
+    {
+        if (should_stop())
+        {
+            alpha = 0;
+            break;
+        }
+
+        Board next(board);
+        next.apply(*it);
+        int score = -negamax(next, opponent(color), depth - 1, ply + 1, -beta, -alpha);
+
+        if (score >= beta)
+        {
+            alpha = beta;
+            break;
+        }
+
+        alpha = max(alpha, score);
+    }
+
+    _history.pop();
+    return alpha;
+}
+
+/**
+ * Searches the board for the best move by running deeper and deeper searches until one of the limits is hit.
+ * Only finished iterations count. If the search is stopped partway through one, the previous iteration's move is kept.
+ *
+ * @param board The board to search. It is not modified.
+ * @param color Color of the player to move.
+ * @param limits When to stop searching.
+ * @param report Called with the result of every finished iteration. May be empty.
+ * @param history Positions the game went through before reaching the board, oldest first. May be NULL.
+ * @return The best move found. If the player has no legal moves, best.from is {-1, -1}.
+ */
+SearchResult Search::run(const Board &board, char color, SearchLimits limits, function<void(const SearchResult &)> report,
+                         const PositionHistory *history)
+{
+    SearchResult result = {{{-1, -1}, {-1, -1}}, 0, 0, 0, 0};
+    TraceScope trace("search");
+
+    _limits = limits;
+    _nodes = 0;
+    _start = chrono::steady_clock::now();
+    _stopped = false;
+
+    Board root(board);
+    vector<Move> moves = root.legal_moves(color);
+
+    if (moves.empty())
+    {
+        return result;
+    }
+
+    orderMoves(root, moves);
+    result.best = moves.front();
+
+    _history = history ? *history : PositionHistory();
+    _history.push(root.hash());
+
+    int max_depth = limits.depth > 0 ? min(limits.depth, MAX_DEPTH) : MAX_DEPTH;
+
+    for (int depth = 1; depth <= max_depth; depth++)
+    {
+        TraceScope trace("iteration", depth);
+        Move best = moves.front();
+        int alpha = -INFINITE_SCORE;
+
+        for (auto it = moves.begin(); it != moves.end(); ++it)
+        {
+            Board next(root);
+            next.apply(*it);
+            int score = -negamax(next, opponent(color), depth - 1, 1, -INFINITE_SCORE, -alpha);
+
+            if (should_stop())
+            {
+                break;
+            }
+
+            if (score > alpha)
+            {
+                alpha = score;
+                best = *it;
+            }
+        }
+
+        // Throw away an iteration that didn't finish. It may have missed the best move entirely.
+        if (_stopped)
+        {
+            break;
+        }
+
+        result.best = best;
+        result.score = alpha;
+        result.depth = depth;
+        result.nodes = _nodes;
+        result.time = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - _start).count();
+
+        if (report)
+        {
+            report(result);
+        }
+
+        // Search the best move first next time, so the deeper iteration cuts off more of the others.
+        rotate(moves.begin(), find(moves.begin(), moves.end(), best), find(moves.begin(), moves.end(), best) + 1);
+
+        // There's no point looking deeper once a forced mate has been found.
+        if (abs(alpha) >= MATE - MAX_DEPTH)
+        {
+            break;
+        }
+    }
+
+    result.nodes = _nodes;
+    result.time = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - _start).count();
+    return result;
+}
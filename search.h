@@ -0,0 +1,65 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "board.h"
+#include "history.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+using namespace std;
+
+// Constants used when scoring positions.
+const int MATE = 100000;            // Score for checkmating the enemy. Mates found sooner score a little higher.
+const int INFINITE_SCORE = 1000000; // Bound larger than any score a position can have.
+const int MAX_DEPTH = 64;           // Deepest iteration a search will ever attempt.
+
+// Limits placed on a single search.
+struct SearchLimits
+{
+    int depth;                // Deepest iteration to search. 0 means no limit.
+    int movetime;             // Milliseconds the search may run for. 0 means no limit.
+    const atomic<bool> *stop; // Set from another thread to end the search early. May be NULL.
+};
+
+// What a search has found so far.
+struct SearchResult
+{
+    Move best;       // Best move found for the player to move.
+    int score;       // Score of the best move in centipawns, from the point of view of the player to move.
+    int depth;       // Depth of the last finished iteration.
+    long long nodes; // Number of positions visited.
+    long long time;  // Milliseconds spent searching.
+};
+
+// An iterative deepening alpha-beta search.
+//
+// Every position visited is a copy of the board it came from, so the board handed to run() is never touched
+// and several searches can safely run at once, as long as each has its own Search.
+class Search
+{
+private:
+    // Attributes.
+    SearchLimits _limits;                     // Limits of the search currently running.
+    long long _nodes;                         // Number of positions visited so far.
+    chrono::steady_clock::time_point _start;  // When the search currently running was started.
+    bool _stopped;                            // True once the search has run out of time or been told to stop.
+    vector<Move> _moves[MAX_DEPTH];           // Moves being tried at each ply. Kept between positions so listing them doesn't allocate.
+    PositionHistory _history;                 // Positions played in the game before the search started, followed by the ones leading to the position being searched.
+
+    bool should_stop();                                                            // Check if the search has been told to stop or has run out of time.
+    int negamax(Board &board, char color, int depth, int ply, int alpha, int beta); // Score a position from the point of view of the player to move.
+
+public:
+    // Constructor.
+    Search() : _limits({0, 0, NULL}), _nodes(0), _stopped(false) {}
+
+    // Search the board for the best move for the given color. report is called after every finished iteration.
+    // history holds the positions the game went through to reach the board, so repeating one of them counts as a draw.
+    SearchResult run(const Board &board, char color, SearchLimits limits, function<void(const SearchResult &)> report = nullptr,
+                     const PositionHistory *history = NULL);
+};
+
+int evaluate(const Board &board, char color); // Score a position in centipawns from the point of view of the given color.
+int pieceValue(char name);                    // Return the material value of a piece in centipawns.
+
+#endif // SEARCH_H
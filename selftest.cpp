@@ -0,0 +1,173 @@
+/**
+ * selftest.cpp
+ *
+ * Checks of the engine's edge cases that neither perft nor the bench signature would notice breaking, like FEN
+ * strings at the limits of what they can hold, or allocations creeping into code that shouldn't make any. Built and
+ * run with make check, which fails if any check does.
+ */
+
+#include "board.h"
+#include "validate.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Number of checks that have failed so far.
+static int failures = 0;
+
+// Number of heap allocations made so far, by any thread.
+static atomic<size_t> allocations(0);
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *memory = malloc(size ? size : 1);
+    if (!memory)
+    {
+        throw bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+/**
+ * Records the result of a check, and says what went wrong if it failed.
+ *
+ * @param passed Whether or not the check passed.
+ * @param what What was checked.
+ */
+static void expect(bool passed, const string &what)
+{
+    if (!passed)
+    {
+        cout << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+/**
+ * Checks that FEN strings with the largest clocks allowed survive a round trip, that larger clocks are turned away,
+ * and that nothing to_fen() writes is ever longer than MAX_FEN_LENGTH.
+ */
+static void checkFenClocks()
+{
+    // Every row as long as it can be, every castling right, an en passant square, and both clocks at their largest.
+    const string longest = "1r1b1k1n/p1p1p1p1/1p1p1p1p/1n1b1r1q/N1B1R1Q1/P1P1P1P1/1P1P1P1P/R1B1K1N1 w - - 9999 9999";
+    Board board;
+    expect(board.set_fen(longest), "set_fen() reads clocks of " + to_string(MAX_FEN_CLOCK));
+    expect(board.to_fen() == longest, "to_fen() writes back clocks of " + to_string(MAX_FEN_CLOCK));
+
+    const string widest = "r3k2r/8/8/3pP3/8/8/8/R3K2R w KQkq d6 9999 9999";
+    expect(board.set_fen(widest) && board.to_fen() == widest, "FEN with every castling right and en passant round trips");
+    expect(static_cast<int>(board.to_fen().size()) <= MAX_FEN_LENGTH, "to_fen() stays within MAX_FEN_LENGTH");
+
+    const char *too_big[] = {
+        "1r1b1k1n/p1p1p1p1/1p1p1p1p/1n1b1r1q/N1B1R1Q1/P1P1P1P1/1P1P1P1P/R1B1K1N1 w - - 10000 1",
+        "1r1b1k1n/p1p1p1p1/1p1p1p1p/1n1b1r1q/N1B1R1Q1/P1P1P1P1/1P1P1P1P/R1B1K1N1 w - - 0 10000",
+        "1r1b1k1n/p1p1p1p1/1p1p1p1p/1n1b1r1q/N1B1R1Q1/P1P1P1P1/1P1P1P1P/R1B1K1N1 w - - 999999999 999999999",
+        "1r1b1k1n/p1p1p1p1/1p1p1p1p/1n1b1r1q/N1B1R1Q1/P1P1P1P1/1P1P1P1P/R1B1K1N1 w - - 4000000000 4000000000",
+    };
+    for (const char *fen : too_big)
+    {
+        Board untouched(widest);
+        expect(!untouched.set_fen(fen) && untouched.to_fen() == widest, string("set_fen() turns away ") + fen);
+    }
+
+    // Playing on past the largest fullmove number still writes a FEN that can be read back.
+    board.set_fen("r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 9999 9999");
+    board.apply(Move{{7, 0}, {6, 0}});
+    Board reread;
+    expect(static_cast<int>(board.to_fen().size()) <= MAX_FEN_LENGTH && reread.set_fen(board.to_fen()),
+           "to_fen() keeps clocks that ran past the limit readable");
+}
+
+/**
+ * Checks that MoveValidator allocates nothing of its own: checking a batch of moves allocates exactly as often as
+ * trying each of them on a board by hand, both on the calling thread and across workers.
+ */
+static void checkValidatorAllocations()
+{
+    const char *fens[] = {
+        "r1bqk1nr/pppp1ppp/2n5/2b1p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "rnb1kbnr/pppp1ppp/8/4p3/5PPq/8/PPPPP2P/RNBQKBNR w KQkq - 1 3",
+    };
+    vector<Board> boards(fens, fens + 3);
+    vector<MoveCheck> checks;
+    while (checks.size() < VALIDATE_PARALLEL_MIN)
+    {
+        for (Board &board : boards)
+        {
+            for (const Move &m : board.legal_moves(board.turn()))
+            {
+                checks.push_back({&board, m});
+            }
+        }
+    }
+    vector<int> results(checks.size());
+
+    // What trying the moves costs on its own, through the same rules the validator uses.
+    Board scratch;
+    size_t before = allocations;
+    for (const MoveCheck &check : checks)
+    {
+        scratch = *check.position;
+        scratch.try_move(check.move);
+    }
+    size_t by_hand = allocations - before;
+
+    for (int threads : {1, 4})
+    {
+        MoveValidator validator(threads);
+        validator.validate(checks.data(), checks.size(), results.data()); // Lets every worker start up first.
+
+        before = allocations;
+        validator.validate(checks.data(), checks.size(), results.data());
+        size_t validated = allocations - before;
+        expect(validated == by_hand, "MoveValidator with " + to_string(threads) + " threads allocates only what the rules do (" +
+                                         to_string(validated) + " allocations, not " + to_string(by_hand) + ")");
+    }
+}
+
+int main()
+{
+    checkFenClocks();
+    checkValidatorAllocations();
+
+    if (failures)
+    {
+        cout << failures << " checks failed." << endl;
+        return 1;
+    }
+
+    cout << "All checks passed." << endl;
+    return 0;
+}
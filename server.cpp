@@ -0,0 +1,601 @@
+#include "server.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sstream>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+using namespace std;
+
+/**
+ * Opens a socket, and either listens on or connects to an address.
+ *
+ * Anything with a slash in it is the path of a Unix socket. Anything else is a TCP port on localhost.
+ * Sockets are non-blocking, and TCP sockets send small replies right away rather than waiting to batch them up.
+ *
+ * @param address Port number, like "9000", or Unix socket path, like "/tmp/chess.sock".
+ * @param listening True to listen for connections, false to connect.
+ * @return The socket, or -1 if it couldn't be opened.
+ */
+int openSocket(const string &address, bool listening)
+{
+    int fd;
+    int result;
+
+    if (address.find('/') != string::npos)
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, address.c_str(), sizeof(addr.sun_path) - 1);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+
+        if (listening)
+        {
+            unlink(address.c_str());
+            result = bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+        }
+        else
+        {
+            result = connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+        }
+    }
+    else
+    {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(atoi(address.c_str()));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        if (listening)
+        {
+            result = bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+        }
+        else
+        {
+            result = connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+        }
+    }
+
+    if (result < 0 || (listening && ::listen(fd, SOMAXCONN) < 0))
+    {
+        close(fd);
+        return -1;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+/**
+ * Returns a short name for why a move was rejected, for use in replies.
+ * @param error Reason the move was rejected.
+ * @return Name of the reason, like "blocked".
+ */
+static const char *moveErrorName(MoveError error)
+{
+    switch (error)
+    {
+    case MOVE_OK:
+        return "ok";
+    case MOVE_OFF_BOARD:
+        return "off-board";
+    case MOVE_NO_PIECE:
+        return "no-piece";
+    case MOVE_NOT_YOUR_PIECE:
+        return "not-your-piece";
+    case MOVE_UNREACHABLE:
+        return "unreachable";
+    case MOVE_BLOCKED:
+        return "blocked";
+    case MOVE_PAWN_CAPTURE:
+        return "pawn-capture";
+    case MOVE_OWN_PIECE:
+        return "own-piece";
+    case MOVE_SUICIDE_CAPTURE:
+    case MOVE_SUICIDE:
+        return "king-vulnerable";
+    case MOVE_CASTLING:
+        return "castling";
+    case MOVE_PROMOTION:
+        return "promotion";
+    }
+    return "ok";
+}
+
+/**
+ * Destructor for the game server. Disconnects every client and stops listening.
+ */
+GameServer::~GameServer()
+{
+    for (auto it = _sessions.begin(); it != _sessions.end(); ++it)
+    {
+        close(it->first);
+    }
+
+    if (_listener >= 0)
+    {
+        close(_listener);
+    }
+
+    if (_epoll >= 0)
+    {
+        close(_epoll);
+    }
+}
+
+/**
+ * Starts listening for clients.
+ * @param address Port number on localhost, like "9000", or Unix socket path, like "/tmp/chess.sock".
+ * @return Whether or not the server could listen on the address.
+ */
+bool GameServer::listen(const string &address)
+{
+    _listener = openSocket(address, true);
+    _epoll = epoll_create1(0);
+
+    if (_listener < 0 || _epoll < 0)
+    {
+        return false;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = _listener;
+    return epoll_ctl(_epoll, EPOLL_CTL_ADD, _listener, &event) == 0;
+}
+
+/**
+ * Handles clients forever, one ready socket at a time.
+ */
+void GameServer::run()
+{
+    struct epoll_event events[256];
+
+    // A client that disconnects while a reply is on its way shouldn't take the server down with it.
+    signal(SIGPIPE, SIG_IGN);
+
+    for (;;)
+    {
+        int count = epoll_wait(_epoll, events, 256, -1);
+
+        for (int i = 0; i < count; i++)
+        {
+            int fd = events[i].data.fd;
+
+            if (fd == _listener)
+            {
+                accept_clients();
+                continue;
+            }
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+            {
+                close_client(fd);
+                continue;
+            }
+
+            if (events[i].events & EPOLLOUT)
+            {
+                write_client(fd);
+            }
+
+            if (events[i].events & EPOLLIN)
+            {
+                read_client(fd);
+            }
+        }
+    }
+}
+
+/**
+ * Accepts every client waiting to connect, and gives each one a new game.
+ * Clients beyond MAX_SESSIONS are turned away.
+ */
+void GameServer::accept_clients()
+{
+    for (;;)
+    {
+        int fd = accept4(_listener, NULL, NULL, SOCK_NONBLOCK);
+        if (fd < 0)
+        {
+            return;
+        }
+
+        if (_sessions.size() >= MAX_SESSIONS)
+        {
+            close(fd);
+            continue;
+        }
+
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &event);
+
+        unique_ptr<Session> session(new Session());
+        session->input_length = 0;
+        _sessions[fd] = move(session);
+    }
+}
+
+/**
+ * Reads whatever a client has sent, and handles every whole line of it.
+ * Whatever is left over stays in the client's input until the rest of the line arrives.
+ *
+ * @param fd The client's socket.
+ */
+void GameServer::read_client(int fd)
+{
+    auto found = _sessions.find(fd);
+    if (found == _sessions.end())
+    {
+        return;
+    }
+
+    Session &session = *found->second;
+
+    // Only read once per wakeup. Reading until the socket runs dry would let a client that sends its next command
+    // while the last one is being handled keep the server to itself, and every other client would have to wait.
+    ssize_t n = read(fd, session.input + session.input_length, SESSION_INPUT - session.input_length);
+
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+    {
+        close_client(fd);
+        return;
+    }
+
+    if (n < 0)
+    {
+        return;
+    }
+
+    session.input_length += n;
+
+    // Handle every whole line that has arrived.
+    size_t start = 0;
+    for (size_t i = session.input_length - n; i < session.input_length; i++)
+    {
+        if (session.input[i] != '\n')
+        {
+            continue;
+        }
+
+        size_t end = i > start && session.input[i - 1] == '\r' ? i - 1 : i;
+        if (!handle(fd, session, string(session.input + start, end - start)))
+        {
+            close_client(fd);
+            return;
+        }
+
+        start = i + 1;
+    }
+
+    // Shuffle the start of the next line to the front.
+    memmove(session.input, session.input + start, session.input_length - start);
+    session.input_length -= start;
+
+    // A line that fills the whole buffer can never be finished.
+    if (session.input_length == SESSION_INPUT)
+    {
+        send(fd, session, "error line too long");
+        close_client(fd);
+        return;
+    }
+}
+
+/**
+ * Sends a client as many of its waiting replies as it will take.
+ * Once they've all gone, the server stops waiting for room to write to it.
+ *
+ * @param fd The client's socket.
+ */
+void GameServer::write_client(int fd)
+{
+    auto found = _sessions.find(fd);
+    if (found == _sessions.end())
+    {
+        return;
+    }
+
+    Session &session = *found->second;
+    ssize_t n = write(fd, session.output.data(), session.output.size());
+
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+    {
+        close_client(fd);
+        return;
+    }
+
+    session.output.erase(0, max<ssize_t>(n, 0));
+
+    if (session.output.empty())
+    {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(_epoll, EPOLL_CTL_MOD, fd, &event);
+    }
+}
+
+/**
+ * Disconnects a client and throws away its game.
+ * @param fd The client's socket.
+ */
+void GameServer::close_client(int fd)
+{
+    close(fd);
+    _sessions.erase(fd);
+}
+
+/**
+ * Sends a reply to a client. If it can't all be sent right away, the rest waits in the client's output
+ * and the server waits for room to write to it.
+ *
+ * @param fd The client's socket.
+ * @param session The client's game.
+ * @param reply The reply to send, without a newline.
+ * @return False if the client has let too many replies pile up, and should be disconnected.
+ */
+bool GameServer::send(int fd, Session &session, const string &reply)
+{
+    string line = reply + "\n";
+
+    // Replies have to go out in order, so if some are already waiting, this one waits behind them.
+    if (session.output.empty())
+    {
+        ssize_t n = write(fd, line.data(), line.size());
+        if (n == static_cast<ssize_t>(line.size()))
+        {
+            return true;
+        }
+
+        line.erase(0, max<ssize_t>(n, 0));
+
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLOUT;
+        event.data.fd = fd;
+        epoll_ctl(_epoll, EPOLL_CTL_MOD, fd, &event);
+    }
+
+    session.output += line;
+    return session.output.size() <= SESSION_OUTPUT;
+}
+
+/**
+ * Handles a single command from a client.
+ *
+ * @param fd The client's socket.
+ * @param session The client's game.
+ * @param command The command, without its newline.
+ * @return False if the client should be disconnected.
+ */
+bool GameServer::handle(int fd, Session &session, const string &command)
+{
+    istringstream iss(command);
+    string first;
+    iss >> first;
+
+    if (first.empty())
+    {
+        return true;
+    }
+
+    if (first == "quit")
+    {
+        return false;
+    }
+
+    if (first == "new")
+    {
+        string fen;
+        getline(iss >> ws, fen);
+        return send(fd, session, session.board.set_fen(fen.empty() ? STARTING_FEN : fen) ? "ok" : "error invalid fen");
+    }
+
+    if (first == "fen")
+    {
+        return send(fd, session, "fen " + session.board.to_fen());
+    }
+
+    if (first == "move")
+    {
+        iss >> first;
+    }
+
+    Move m;
+    if (!parseMove(first, m))
+    {
+        return send(fd, session, "error unknown command");
+    }
+
+    MoveResult result = session.board.try_move(m);
+    if (result.error != MOVE_OK)
+    {
+        return send(fd, session, string("illegal ") + moveErrorName(result.error));
+    }
+
+    const char *outcomes[] = {"ok good", "ok check", "ok checkmate", "ok stalemate"};
+    return send(fd, session, outcomes[result.outcome]);
+}
+
+/**
+ * Plays games against a running server over lots of connections at once, and reports how quickly it replies.
+ *
+ * Every connection has exactly one request waiting on the server at a time, and sends the next one as soon as
+ * the reply arrives. Each game shuffles the knights out and back twice, then starts a new game.
+ *
+ * @param address Address the server is listening on.
+ * @param connections Number of connections to open.
+ * @param requests Total number of requests to send across every connection.
+ * @return 0 if every request got a reply, 1 otherwise, like when the server closes a connection.
+ */
+int runLoadGenerator(const string &address, int connections, long long requests)
+{
+    const char *script[] = {"g1f3", "g8f6", "f3g1", "f6g8", "g1f3", "g8f6", "f3g1", "f6g8", "new"};
+    const int script_length = 9;
+
+    // Where each connection is in its game, and when its request was sent.
+    struct Client
+    {
+        int fd;
+        int step;
+        chrono::steady_clock::time_point sent;
+        string input;
+    };
+
+    signal(SIGPIPE, SIG_IGN);
+
+    int epoll = epoll_create1(0);
+    vector<Client> clients(connections);
+    vector<long long> latencies; // Time between sending each request and getting its reply, in nanoseconds.
+    latencies.reserve(requests);
+    long long sent = 0;
+    int lost = 0; // Connections the server closed, or that broke, before replying.
+
+    auto send_next = [&](Client &client) {
+        string line = string(script[client.step]) + "\n";
+        client.sent = chrono::steady_clock::now();
+        sent++;
+        return write(client.fd, line.data(), line.size()) == static_cast<ssize_t>(line.size());
+    };
+
+    for (int i = 0; i < connections; i++)
+    {
+        clients[i].fd = openSocket(address, false);
+        clients[i].step = 0;
+
+        if (clients[i].fd < 0)
+        {
+            cout << "Couldn't connect to " << address << "." << endl;
+            return 1;
+        }
+
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u32 = i;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, clients[i].fd, &event);
+    }
+
+    auto start = chrono::steady_clock::now();
+
+    for (int i = 0; i < connections && sent < requests; i++)
+    {
+        send_next(clients[i]);
+    }
+
+    struct epoll_event events[256];
+    int waiting = min<long long>(connections, requests); // Connections with a request the server hasn't replied to yet.
+
+    while (waiting > 0)
+    {
+        int count = epoll_wait(epoll, events, 256, 5000);
+        if (count <= 0)
+        {
+            cout << "The server stopped replying." << endl;
+            break;
+        }
+
+        for (int e = 0; e < count; e++)
+        {
+            Client &client = clients[events[e].data.u32];
+            char buffer[512];
+            ssize_t n = read(client.fd, buffer, sizeof(buffer));
+
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            {
+                continue;
+            }
+
+            // The connection is closed or broken, so its request will never be answered.
+            if (n <= 0)
+            {
+                epoll_ctl(epoll, EPOLL_CTL_DEL, client.fd, NULL);
+                close(client.fd);
+                client.fd = -1;
+                lost++;
+                waiting--;
+                continue;
+            }
+
+            client.input.append(buffer, n);
+            if (client.input.back() != '\n')
+            {
+                continue;
+            }
+
+            latencies.push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - client.sent).count());
+            client.input.clear();
+            client.step = (client.step + 1) % script_length;
+
+            if (sent < requests)
+            {
+                send_next(client);
+            }
+            else
+            {
+                waiting--;
+            }
+        }
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    for (auto it = clients.begin(); it != clients.end(); ++it)
+    {
+        if (it->fd >= 0)
+        {
+            close(it->fd);
+        }
+    }
+    close(epoll);
+
+    if (lost)
+    {
+        cout << lost << " of " << connections << " connections were closed before the server replied." << endl;
+    }
+
+    if (latencies.empty())
+    {
+        return 1;
+    }
+
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) { return latencies[min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))] / 1000.0; };
+
+    cout << latencies.size() << " requests over " << connections << " connections in " << seconds << " s: "
+         << static_cast<long long>(latencies.size() / max(seconds, 1e-9)) << " requests/s.\n"
+         << "Latency (us): p50 " << percentile(0.50) << ", p90 " << percentile(0.90) << ", p99 " << percentile(0.99)
+         << ", max " << latencies.back() / 1000.0 << endl;
+
+    return static_cast<long long>(latencies.size()) == requests && !lost ? 0 : 1;
+}
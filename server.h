@@ -0,0 +1,61 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "board.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+using namespace std;
+
+// Limits that keep the memory used by each game on the server bounded.
+const size_t SESSION_INPUT = 256;   // Longest line a client may send, in bytes.
+const size_t SESSION_OUTPUT = 4096; // Most replies a client may leave unread, in bytes, before it's disconnected.
+const size_t MAX_SESSIONS = 16384;  // Most clients that may be connected at once.
+
+// One client connected to the server, playing a single game.
+struct Session
+{
+    Board board;                // The client's game.
+    char input[SESSION_INPUT];  // Bytes received from the client that don't make up a whole line yet.
+    size_t input_length;        // Number of bytes in input.
+    string output;              // Replies that couldn't be sent right away, because the client isn't reading fast enough.
+};
+
+// Hosts lots of independent games at once from a single thread.
+//
+// Every client gets its own board. Sockets never block: epoll says which clients have something to read or room
+// to write, and a client's commands are handled as soon as a whole line of them has arrived.
+//
+// The protocol is one command per line:
+//   e2e4 (or move e2e4)  Move a piece. Replies "ok good", "ok check", "ok checkmate", "ok stalemate", or "illegal <reason>".
+//   new [fen]            Start a new game, from the starting position or the given one. Replies "ok".
+//   fen                  Replies "fen <the current position>".
+//   quit                 Disconnect.
+class GameServer
+{
+private:
+    // Attributes.
+    int _epoll;                                        // epoll instance watching the listening socket and every client.
+    int _listener;                                     // Socket new clients connect to.
+    unordered_map<int, unique_ptr<Session>> _sessions; // Every connected client's game, by socket.
+
+    void accept_clients();                                        // Accept every client waiting to connect.
+    void read_client(int fd);                                     // Read whatever a client has sent, and handle every whole line of it.
+    void write_client(int fd);                                    // Send a client the replies it wasn't ready for before.
+    void close_client(int fd);                                    // Disconnect a client and throw away its game.
+    bool handle(int fd, Session &session, const string &command); // Handle a single command. Return false if the client should be disconnected.
+    bool send(int fd, Session &session, const string &reply);     // Send a reply to a client. Return false if it has too many unread replies.
+
+public:
+    // Constructor and destructor.
+    GameServer() : _epoll(-1), _listener(-1) {} // Default constructor.
+    ~GameServer();                              // Disconnect every client and stop listening.
+
+    bool listen(const string &address); // Start listening on a TCP port on localhost, like "9000", or a Unix socket path, like "/tmp/chess.sock".
+    void run();                         // Handle clients forever.
+};
+
+int openSocket(const string &address, bool listening);                            // Open a socket, and either listen on or connect to the address.
+int runLoadGenerator(const string &address, int connections, long long requests); // Play games against a server as fast as it allows and report its latency.
+
+#endif // SERVER_H
@@ -3,22 +3,23 @@
 
 // An individual square on the chess board.
 //
-// Is either occupied or not occupied by a piece.
+// Is either occupied or not occupied by a piece. The piece is kept in the square itself rather than pointed to,
+// so a board full of squares can be copied byte for byte.
 class Square
 {
 private:
     // Attributes.
     bool _occupied; // True if the square if occupied.
-    Piece *_piece;  // Pointer to a piece occupying the square.
+    Piece _piece;   // Piece occupying the square. Left as it was once the square is emptied.
 
 public:
     // Constructors.
-    Square() : _occupied(false), _piece(NULL) {} // Default constructor.
-    Square(const Square &s) : _occupied(s._occupied), _piece(s._piece) {}
+    Square() : _occupied(false) {} // Default constructor.
 
     // Getters.
-    bool occupied() const { return _occupied; } // Return occupied bool of square.
-    Piece *piece() const { return _piece; }     // Return piece pointer occupying square.
+    bool occupied() const { return _occupied; }    // Return occupied bool of square.
+    Piece *piece() { return &_piece; }             // Return a pointer to the piece occupying the square.
+    const Piece *piece() const { return &_piece; } // Return a pointer to the piece occupying the square, which can't be changed through it.
 
     // Remove a piece from the square.
     //
@@ -29,14 +30,14 @@ public:
         _occupied = false;
     }
 
-    // Sets the location of a piece to the location of this square on the board, renders it
-    // occupied, and points to the piece.
-    void set_piece(Piece *piece, pair<int, int> location)
+    // Puts a copy of a piece on this square, moves it to the location of this square on the board, and renders
+    // the square occupied.
+    void set_piece(const Piece &piece, pair<int, int> location)
     {
         _occupied = true;
         _piece = piece;
-        _piece->move(location);
+        _piece.move(location);
     }
 };
 
-#endif // SQUARE_H
\ No newline at end of file
+#endif // SQUARE_H
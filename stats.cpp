@@ -0,0 +1,104 @@
+#include "stats.h"
+#include <chrono>
+#include <sstream>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+using namespace std;
+
+// Totals for every measured function.
+static FunctionStats STATS[STAT_FUNCTIONS];
+
+// Names of the measured functions, in the order of StatFunction.
+static const char *const STAT_NAMES[STAT_FUNCTIONS] = {"try_move", "is_suicide", "is_checkmate", "is_check"};
+
+/**
+ * Starts measuring a call to a function.
+ * @param function The function being called.
+ */
+StatScope::StatScope(StatFunction function) : _function(function), _start(statTicks()), _candidates(0)
+{
+}
+
+/**
+ * Adds the call to the function's totals. Relaxed atomics are enough, since the totals are only ever read
+ * after the work being measured is done.
+ */
+StatScope::~StatScope()
+{
+    FunctionStats &stats = STATS[_function];
+    stats.calls.fetch_add(1, memory_order_relaxed);
+    stats.ticks.fetch_add(statTicks() - _start, memory_order_relaxed);
+    stats.candidates.fetch_add(_candidates, memory_order_relaxed);
+}
+
+/**
+ * Reads the clock used for timing. On x86 that's the cycle counter, which is much cheaper to read than the
+ * system clock. Elsewhere it's the steady clock in nanoseconds.
+ *
+ * @return The current time, in the units named by statTickUnits().
+ */
+uint64_t statTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * Names the units statTicks() counts in.
+ * @return "cycles" on x86, "ns" elsewhere.
+ */
+const char *statTickUnits()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return "cycles";
+#else
+    return "ns";
+#endif
+}
+
+/**
+ * Sets every total back to 0.
+ */
+void resetStats()
+{
+    for (int i = 0; i < STAT_FUNCTIONS; i++)
+    {
+        STATS[i].calls = 0;
+        STATS[i].ticks = 0;
+        STATS[i].candidates = 0;
+    }
+}
+
+/**
+ * Describes every total as a JSON object, like:
+ * {"enabled": true, "units": "cycles", "functions": {"try_move": {"calls": 2, "ticks": 900, ...}, ...}}
+ *
+ * @return The JSON object. If the instrumentation isn't compiled in, it only says so.
+ */
+string statsJson()
+{
+    ostringstream out;
+
+#ifndef CHESS_STATS
+    out << "{\"enabled\": false}";
+#else
+    out << "{\"enabled\": true, \"units\": \"" << statTickUnits() << "\", \"functions\": {";
+    for (int i = 0; i < STAT_FUNCTIONS; i++)
+    {
+        uint64_t calls = STATS[i].calls;
+        uint64_t ticks = STATS[i].ticks;
+        uint64_t candidates = STATS[i].candidates;
+
+        out << (i ? ", " : "") << "\"" << STAT_NAMES[i] << "\": {\"calls\": " << calls << ", \"ticks\": " << ticks
+            << ", \"ticks_per_call\": " << (calls ? ticks / calls : 0) << ", \"candidates\": " << candidates
+            << ", \"candidates_per_call\": " << (calls ? static_cast<double>(candidates) / calls : 0.0) << "}";
+    }
+    out << "}}";
+#endif
+
+    return out.str();
+}
@@ -0,0 +1,63 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+using namespace std;
+
+// Instrumentation for the move validation hot path: how often each function is called, how long it takes, and how
+// many candidate squares or moves it looks at.
+//
+// It's only compiled in when CHESS_STATS is defined (make stats). Otherwise STAT_SCOPE and STAT_CANDIDATES expand to
+// nothing, so the functions being measured are exactly what they'd be without it.
+
+// Functions that are measured.
+enum StatFunction
+{
+    STAT_TRY_MOVE,     // Board::try_move(). Candidates are the squares on the path of the move.
+    STAT_IS_SUICIDE,   // Board::is_suicide(). Candidates are the enemy squares looked at.
+    STAT_IS_CHECKMATE, // Board::is_checkmate(), when it has to look for a legal move. Candidates aren't counted.
+    STAT_IS_CHECK,     // Board::is_check(). Candidates are the squares the moved piece attacks.
+    STAT_FUNCTIONS     // Number of functions that are measured.
+};
+
+// Totals for a single function, shared by every thread. Time includes any measured functions it calls.
+struct FunctionStats
+{
+    atomic<uint64_t> calls;      // Number of calls.
+    atomic<uint64_t> ticks;      // Total time spent in it, in the units of statTicks().
+    atomic<uint64_t> candidates; // Total candidates looked at.
+};
+
+// Measures one call to a function from construction to destruction, and adds it to the function's totals.
+class StatScope
+{
+private:
+    // Attributes.
+    StatFunction _function; // Function being measured.
+    uint64_t _start;        // Ticks when the call started.
+    uint64_t _candidates;   // Candidates looked at so far.
+
+public:
+    // Constructor and destructor.
+    explicit StatScope(StatFunction function); // Start measuring a call.
+    ~StatScope();                              // Add the call to the function's totals.
+
+    void candidates(uint64_t count) { _candidates += count; } // Count candidates looked at by the call.
+};
+
+#ifdef CHESS_STATS
+#define STAT_SCOPE(function) StatScope stat_scope(function)
+#define STAT_CANDIDATES(count) stat_scope.candidates(count)
+#else
+#define STAT_SCOPE(function)
+#define STAT_CANDIDATES(count)
+#endif
+
+uint64_t statTicks();        // Read the clock used for timing: the CPU's cycle counter where there is one, nanoseconds otherwise.
+const char *statTickUnits(); // Name of the units statTicks() counts in: "cycles" or "ns".
+void resetStats();           // Set every total back to 0.
+string statsJson();          // Describe every total as a JSON object.
+
+#endif // STATS_H
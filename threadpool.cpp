@@ -0,0 +1,99 @@
+#include "threadpool.h"
+#include "trace.h"
+using namespace std;
+
+/**
+ * Constructor for the thread pool. Starts every worker, and leaves them waiting for a job.
+ * @param threads Number of worker threads. If 0, one per core is started.
+ */
+ThreadPool::ThreadPool(int threads) : _count(0), _next(0), _busy(0), _generation(0), _quit(false)
+{
+    if (threads <= 0)
+    {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+
+    for (int i = 0; i < threads; i++)
+    {
+        _workers.push_back(thread(&ThreadPool::work, this, i));
+    }
+}
+
+/**
+ * Destructor for the thread pool. Tells every worker to stop, and waits until they have.
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(_mutex);
+        _quit = true;
+    }
+    _wake.notify_all();
+
+    for (auto it = _workers.begin(); it != _workers.end(); ++it)
+    {
+        it->join();
+    }
+}
+
+/**
+ * Runs a job on every worker and waits for every item of it to be finished.
+ *
+ * @param count Number of items in the job.
+ * @param job Called once for every item, with the item number and the number of the worker running it.
+ */
+void ThreadPool::run(size_t count, function<void(size_t item, int worker)> job)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    unique_lock<mutex> lock(_mutex);
+    _job = job;
+    _count = count;
+    _next = 0;
+    _busy = _workers.size();
+    _generation++;
+    _wake.notify_all();
+
+    _done.wait(lock, [this]() { return _busy == 0; });
+    _job = nullptr;
+}
+
+/**
+ * Loop run by every worker. Waits for a job, claims and runs items until there are none left, and then waits again.
+ * @param worker Number of this worker.
+ */
+void ThreadPool::work(int worker)
+{
+    unsigned generation = 0; // Last job this worker took part in.
+    traceThreadName("worker " + to_string(worker));
+
+    for (;;)
+    {
+        {
+            unique_lock<mutex> lock(_mutex);
+            _wake.wait(lock, [this, generation]() { return _quit || _generation != generation; });
+
+            if (_quit)
+            {
+                return;
+            }
+
+            generation = _generation;
+        }
+
+        for (size_t item = _next++; item < _count; item = _next++)
+        {
+            TraceScope trace("item", item);
+            _job(item, worker);
+        }
+
+        lock_guard<mutex> lock(_mutex);
+        if (--_busy == 0)
+        {
+            _done.notify_all();
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// A fixed set of worker threads that share the items of a job between them.
+//
+// The threads are started once and then reused for every job, so handing out lots of small jobs stays cheap.
+// Items are claimed one at a time from a shared counter, so a worker that finishes early simply takes more of them.
+class ThreadPool
+{
+private:
+    // Attributes.
+    vector<thread> _workers;          // Threads doing the work.
+    mutex _mutex;                     // Held while starting, finishing, or waiting on a job.
+    condition_variable _wake;         // Signalled when a new job starts or the pool is shutting down.
+    condition_variable _done;         // Signalled when the last worker finishes its part of a job.
+    function<void(size_t, int)> _job; // Job currently running. Called with an item number and a worker number.
+    size_t _count;                    // Number of items in the job currently running.
+    atomic<size_t> _next;             // Next item of the current job that hasn't been claimed yet.
+    int _busy;                        // Number of workers still working on the current job.
+    unsigned _generation;             // Goes up by one for every job, so workers can tell a new job from an old one.
+    bool _quit;                       // True once the pool is shutting down.
+
+    void work(int worker); // Loop run by every worker thread.
+
+public:
+    // Constructor and destructor.
+    explicit ThreadPool(int threads = 0); // Start the given number of workers, or one per core if 0.
+    ~ThreadPool();                        // Wait for the workers to finish up and stop them.
+
+    int size() const { return _workers.size(); } // Retrieve the number of worker threads.
+
+    // Call job once for every item from 0 to count - 1, spread across the workers, and wait for them all to finish.
+    // The worker number passed to job is between 0 and size() - 1, so it can be used to give each worker its own scratch space.
+    void run(size_t count, function<void(size_t item, int worker)> job);
+};
+
+#endif // THREADPOOL_H
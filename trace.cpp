@@ -0,0 +1,162 @@
+#include "trace.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+using namespace std;
+
+atomic<bool> traceEnabled(false);
+
+// Events recorded by a single thread. Only that thread writes to it, so it never needs a lock.
+struct TraceBuffer
+{
+    int thread;                        // Number of the thread in the trace, in the order threads first recorded something.
+    string name;                       // Name of the thread in the trace.
+    atomic<size_t> recorded;           // Number of events recorded so far. Only the last TRACE_CAPACITY are kept.
+    TraceEvent events[TRACE_CAPACITY]; // The events, used as a ring.
+};
+
+static mutex traceMutex;                            // Held while a thread's buffer is created, and while the trace is written.
+static vector<TraceBuffer *> traceBuffers;          // Every thread's buffer. Never freed, since threads may finish before the trace is written.
+static string tracePath;                            // File the trace is written to.
+static chrono::steady_clock::time_point traceStart; // When tracing started.
+static thread_local TraceBuffer *threadBuffer;      // Buffer of the calling thread. NULL until it records something.
+static thread_local string threadName;              // Name given to the calling thread before its buffer existed.
+
+/**
+ * Finds the calling thread's buffer, creating it the first time. Only creating it takes a lock.
+ * @return The calling thread's buffer.
+ */
+static TraceBuffer *buffer()
+{
+    if (!threadBuffer)
+    {
+        TraceBuffer *created = new TraceBuffer();
+        lock_guard<mutex> lock(traceMutex);
+        created->thread = traceBuffers.size() + 1;
+        created->name = threadName.empty() ? "thread " + to_string(created->thread) : threadName;
+        traceBuffers.push_back(created);
+        threadBuffer = created;
+    }
+
+    return threadBuffer;
+}
+
+/**
+ * Works out how long it's been since tracing started.
+ * @return Nanoseconds since tracing started.
+ */
+uint64_t traceNow()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - traceStart).count();
+}
+
+/**
+ * Adds an event to the calling thread's buffer, overwriting its oldest event if the buffer is full.
+ * @param event The event to add.
+ */
+void traceRecord(const TraceEvent &event)
+{
+    TraceBuffer *b = buffer();
+    size_t n = b->recorded.load(memory_order_relaxed);
+    b->events[n % TRACE_CAPACITY] = event;
+
+    // Publish the event only after it's written, so whoever writes the trace never sees half of one.
+    b->recorded.store(n + 1, memory_order_release);
+}
+
+/**
+ * Writes the trace out when the program exits.
+ */
+static void flushAtExit()
+{
+    flushTrace();
+}
+
+/**
+ * Starts recording events, and arranges for them to be written to a file when the program exits.
+ *
+ * @param path Path of the file to write the trace to.
+ * @return Whether or not the file can be written.
+ */
+bool startTrace(const string &path)
+{
+    if (!ofstream(path))
+    {
+        return false;
+    }
+
+    tracePath = path;
+    traceStart = chrono::steady_clock::now();
+    traceEnabled = true;
+    atexit(flushAtExit);
+    return true;
+}
+
+/**
+ * Names the calling thread in the trace.
+ * @param name The thread's name, like "worker 2".
+ */
+void traceThreadName(const string &name)
+{
+    threadName = name;
+
+    if (threadBuffer)
+    {
+        lock_guard<mutex> lock(traceMutex);
+        threadBuffer->name = name;
+    }
+}
+
+/**
+ * Writes every thread's events to the trace file in the Chrome trace event format, as complete ("X") events
+ * with times in microseconds, plus a metadata event naming each thread.
+ *
+ * Threads may still be recording while this runs. Only the events each one had published when its buffer was
+ * reached are written, and a thread that laps its whole ring in the meantime may have its oldest events garbled.
+ *
+ * @return Whether or not the file could be written.
+ */
+bool flushTrace()
+{
+    if (tracePath.empty())
+    {
+        return true;
+    }
+
+    ofstream out(tracePath);
+    if (!out)
+    {
+        return false;
+    }
+
+    lock_guard<mutex> lock(traceMutex);
+    out << fixed << setprecision(3);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"chess\"}}";
+
+    for (auto it = traceBuffers.begin(); it != traceBuffers.end(); ++it)
+    {
+        TraceBuffer *b = *it;
+        out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << b->thread << ", \"args\": {\"name\": \"" << b->name << "\"}}";
+
+        size_t recorded = b->recorded.load(memory_order_acquire);
+        size_t first = recorded > TRACE_CAPACITY ? recorded - TRACE_CAPACITY : 0;
+        for (size_t i = first; i < recorded; i++)
+        {
+            const TraceEvent &event = b->events[i % TRACE_CAPACITY];
+            out << ",\n{\"name\": \"" << event.name << "\", \"cat\": \"chess\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << b->thread
+                << ", \"ts\": " << event.start / 1000.0 << ", \"dur\": " << event.length / 1000.0;
+            if (event.arg >= 0)
+            {
+                out << ", \"args\": {\"value\": " << event.arg << "}";
+            }
+            out << "}";
+        }
+    }
+
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,61 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+using namespace std;
+
+// Number of events each thread keeps. Once a thread has recorded more, its oldest events are overwritten.
+const size_t TRACE_CAPACITY = 1 << 16;
+
+// A timeline recorder for finding out where threads spend their time and where they sit idle.
+//
+// Every thread records into a ring buffer of its own, so recording an event never takes a lock or waits on another
+// thread. The buffers are written out together as a Chrome trace, which loads into Perfetto or chrome://tracing.
+// Until tracing is started, recording an event costs a single check of a flag.
+
+// A span of time spent doing one thing on one thread.
+struct TraceEvent
+{
+    const char *name; // What the thread was doing. Must outlive the tracer, so it's always a string literal.
+    uint64_t start;   // Nanoseconds since tracing started.
+    uint64_t length;  // Nanoseconds the span lasted.
+    long long arg;    // A number describing the span, like the depth of a search iteration. -1 if there isn't one.
+};
+
+extern atomic<bool> traceEnabled; // True while events are being recorded.
+
+uint64_t traceNow();                       // Nanoseconds since tracing started.
+void traceRecord(const TraceEvent &event); // Add an event to the calling thread's buffer.
+
+// Records the span of time from construction to destruction as an event, if tracing is on.
+class TraceScope
+{
+private:
+    // Attributes.
+    const char *_name; // What the thread is doing. NULL if tracing was off when the span started.
+    uint64_t _start;   // Nanoseconds since tracing started, when the span started.
+    long long _arg;    // A number describing the span. -1 if there isn't one.
+
+public:
+    // Constructor and destructor. The span starts when the scope is entered and is recorded when it's left.
+    // While tracing is off, the only cost is checking the flag.
+    explicit TraceScope(const char *name, long long arg = -1)
+        : _name(traceEnabled.load(memory_order_acquire) ? name : NULL), _start(_name ? traceNow() : 0), _arg(arg) {}
+    ~TraceScope()
+    {
+        if (_name)
+        {
+            traceRecord({_name, _start, traceNow() - _start, _arg});
+        }
+    }
+
+    void arg(long long value) { _arg = value; } // Set the number describing the span.
+};
+
+bool startTrace(const string &path);      // Start recording, and write the trace to a file when the program exits. Return false if the file can't be written.
+void traceThreadName(const string &name); // Name the calling thread in the trace.
+bool flushTrace();                        // Write every thread's events out as a Chrome trace. Return false if the file can't be written.
+
+#endif // TRACE_H
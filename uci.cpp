@@ -0,0 +1,305 @@
+#include "uci.h"
+#include <chrono>
+#include <iostream>
+using namespace std;
+
+/**
+ * Adds a line to the back of the queue.
+ * Should only ever be called from the one thread that pushes.
+ *
+ * @param line The line to add.
+ * @return Whether or not there was room for the line.
+ */
+bool CommandQueue::push(const string &line)
+{
+    size_t tail = _tail.load(memory_order_relaxed);
+
+    if (tail - _head.load(memory_order_acquire) == CAPACITY)
+    {
+        return false;
+    }
+
+    _lines[tail % CAPACITY] = line;
+    _tail.store(tail + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Takes the line at the front of the queue.
+ * Should only ever be called from the one thread that pops.
+ *
+ * @param line Set to the line taken from the queue.
+ * @return Whether or not there was a line to take.
+ */
+bool CommandQueue::pop(string &line)
+{
+    size_t head = _head.load(memory_order_relaxed);
+
+    if (head == _tail.load(memory_order_acquire))
+    {
+        return false;
+    }
+
+    line = move(_lines[head % CAPACITY]);
+    _head.store(head + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Constructor for the UCI engine. Its board starts at the standard starting position.
+ */
+Uci::Uci() : _stop(false)
+{
+}
+
+/**
+ * Reads lines from stdin into the command queue.
+ * Stops after passing on "quit". If the input ends first, a "quit" is passed on in its place.
+ */
+void Uci::read()
+{
+    string line;
+
+    while (getline(cin, line))
+    {
+        while (!_commands.push(line))
+        {
+            this_thread::yield();
+        }
+
+        istringstream iss(line);
+        string first;
+        if (iss >> first && first == "quit")
+        {
+            return;
+        }
+    }
+
+    while (!_commands.push("quit"))
+    {
+        this_thread::yield();
+    }
+}
+
+/**
+ * Writes a single line to stdout and flushes it, so the GUI sees it right away.
+ * @param line The line to write.
+ */
+void Uci::send(const string &line)
+{
+    lock_guard<mutex> lock(_out);
+    cout << line << endl;
+}
+
+/**
+ * Sets up the board from a "position" command.
+ * The position is either "startpos" or "fen" followed by a FEN string. Moves are given in coordinate notation, like "e2e4".
+ * The whole command is worked out on a scratch board first, so an invalid FEN or an illegal move leaves the position
+ * from the last command untouched.
+ *
+ * @param iss The rest of the command, after "position".
+ */
+void Uci::position(istringstream &iss)
+{
+    string token;
+    string fen;
+    iss >> token;
+
+    if (token == "startpos")
+    {
+        fen = STARTING_FEN;
+        iss >> token;
+    }
+    else if (token == "fen")
+    {
+        while (iss >> token && token != "moves")
+        {
+            fen += (fen.empty() ? "" : " ") + token;
+        }
+    }
+
+    Board board;
+    PositionHistory history;
+    if (fen.empty() || !board.set_fen(fen))
+    {
+        send("info string invalid position " + fen);
+        return;
+    }
+
+    while (iss >> token)
+    {
+        Move m;
+        vector<Move> moves = board.legal_moves(board.turn());
+
+        if (!parseMove(token, m) || find(moves.begin(), moves.end(), m) == moves.end())
+        {
+            send("info string illegal move " + token);
+            return;
+        }
+
+        history.push(board.hash());
+        board.apply(m);
+    }
+
+    _board = board;
+    swap(_history, history);
+}
+
+/**
+ * Starts a search from a "go" command.
+ *
+ * "depth" and "movetime" are taken as given. If the clocks are given instead, a slice of the remaining time is used.
+ * With no limits at all, or with "infinite", the search runs until it's told to stop.
+ *
+ * @param iss The rest of the command, after "go".
+ */
+void Uci::go(istringstream &iss)
+{
+    SearchLimits limits = {0, 0, &_stop};
+    int time[2] = {0, 0};      // Time left on the white and black clocks in milliseconds.
+    int increment[2] = {0, 0}; // Time added to the white and black clocks after every move in milliseconds.
+    int moves_to_go = 0;       // Number of moves until the clocks are topped up. 0 if they never are.
+    bool infinite = false;     // True if the search must keep going until told to stop.
+    string token;
+
+    while (iss >> token)
+    {
+        if (token == "depth")
+        {
+            iss >> limits.depth;
+        }
+        else if (token == "movetime")
+        {
+            iss >> limits.movetime;
+        }
+        else if (token == "wtime" || token == "btime")
+        {
+            iss >> time[token[0] == 'b'];
+        }
+        else if (token == "winc" || token == "binc")
+        {
+            iss >> increment[token[0] == 'b'];
+        }
+        else if (token == "movestogo")
+        {
+            iss >> moves_to_go;
+        }
+        else if (token == "infinite")
+        {
+            infinite = true;
+        }
+    }
+
+    int side = _board.turn() == BLACK;
+    if (!infinite && !limits.movetime && time[side] > 0)
+    {
+        limits.movetime = max(1, time[side] / (moves_to_go > 0 ? moves_to_go + 1 : 30) + increment[side] / 2);
+        limits.movetime = min(limits.movetime, max(1, time[side] - 50));
+    }
+
+    stop();
+    _stop = false;
+
+    Board board(_board);
+    PositionHistory history(_history);
+    _searcher = thread([this, board, history, limits, infinite]() {
+        Search search;
+        SearchResult result = search.run(board, board.turn(), limits, [this](const SearchResult &r) {
+            ostringstream info;
+            info << "info depth " << r.depth << " score ";
+            if (abs(r.score) >= MATE - MAX_DEPTH)
+            {
+                info << "mate " << (r.score > 0 ? (MATE - r.score + 1) / 2 : -(MATE + r.score) / 2);
+            }
+            else
+            {
+                info << "cp " << r.score;
+            }
+            info << " nodes " << r.nodes << " time " << r.time << " nps " << r.nodes * 1000 / max(1LL, r.time)
+                 << " pv " << moveName(r.best);
+            send(info.str());
+        }, &history);
+
+        // The protocol doesn't allow a best move to be reported during an infinite search until it's been told to stop.
+        while (infinite && !_stop)
+        {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+
+        send("bestmove " + (result.best.from.first < 0 ? string("0000") : moveName(result.best)));
+    });
+}
+
+/**
+ * Stops the current search, if there is one, and waits for it to report its best move.
+ */
+void Uci::stop()
+{
+    if (_searcher.joinable())
+    {
+        _stop = true;
+        _searcher.join();
+    }
+}
+
+/**
+ * Handles UCI commands until told to quit.
+ *
+ * The queue is polled every 100 microseconds, which keeps replies well under a millisecond
+ * without the main thread spinning a core while a search is running.
+ */
+void Uci::run()
+{
+    _reader = thread(&Uci::read, this);
+
+    for (;;)
+    {
+        string line;
+        if (!_commands.pop(line))
+        {
+            this_thread::sleep_for(chrono::microseconds(100));
+            continue;
+        }
+
+        istringstream iss(line);
+        string command;
+        iss >> command;
+
+        if (command == "uci")
+        {
+            send("id name Ascii-Chess");
+            send("id author Tanner Sundwall");
+            send("uciok");
+        }
+        else if (command == "isready")
+        {
+            send("readyok");
+        }
+        else if (command == "ucinewgame")
+        {
+            stop();
+            _board.set_fen(STARTING_FEN);
+            _history.clear();
+        }
+        else if (command == "position")
+        {
+            stop();
+            position(iss);
+        }
+        else if (command == "go")
+        {
+            go(iss);
+        }
+        else if (command == "stop")
+        {
+            stop();
+        }
+        else if (command == "quit")
+        {
+            stop();
+            break;
+        }
+    }
+
+    _reader.join();
+}
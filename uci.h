@@ -0,0 +1,63 @@
+#ifndef UCI_H
+#define UCI_H
+
+#include "board.h"
+#include "search.h"
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+using namespace std;
+
+// A fixed-size queue passing lines of input from the thread reading stdin to the thread handling them.
+//
+// Exactly one thread may push and exactly one thread may pop. That lets both sides get away without a lock:
+// the pushing thread is the only one that moves _tail, and the popping thread is the only one that moves _head.
+class CommandQueue
+{
+private:
+    // Attributes.
+    static const size_t CAPACITY = 256; // Number of lines the queue can hold at once.
+    string _lines[CAPACITY];            // Lines waiting to be handled. Slots are reused once popped.
+    atomic<size_t> _head;               // Number of lines popped so far.
+    atomic<size_t> _tail;               // Number of lines pushed so far.
+
+public:
+    // Constructor.
+    CommandQueue() : _head(0), _tail(0) {}
+
+    bool push(const string &line); // Add a line to the back of the queue. Return false if the queue is full.
+    bool pop(string &line);        // Take the line at the front of the queue. Return false if the queue is empty.
+};
+
+// Plays chess through the Universal Chess Interface, so the game can be driven by chess GUIs and tournament managers.
+//
+// A dedicated thread reads stdin and feeds the command queue, and searches run on a thread of their own.
+// That leaves the main thread free to answer commands like "isready" and "stop" immediately, even mid-search.
+class Uci
+{
+private:
+    // Attributes.
+    Board _board;             // Position the next search will start from.
+    PositionHistory _history; // Positions the game went through to reach _board.
+    CommandQueue _commands;   // Lines read from stdin that haven't been handled yet.
+    thread _reader;           // Thread reading lines from stdin.
+    thread _searcher;         // Thread running the current search, if any.
+    atomic<bool> _stop;       // Set to tell the current search to stop and report its best move.
+    mutex _out;               // Held while writing a line to stdout, since both the main and search threads write.
+
+    void read();                       // Read lines from stdin into the command queue until "quit" or the end of input.
+    void send(const string &line);     // Write a single line to stdout.
+    void position(istringstream &iss); // Set up the board as described by a "position" command.
+    void go(istringstream &iss);       // Start a search as described by a "go" command.
+    void stop();                       // Stop the current search, if any, and wait for it to report its best move.
+
+public:
+    // Constructor.
+    Uci();
+
+    void run(); // Handle commands until told to quit.
+};
+
+#endif // UCI_H
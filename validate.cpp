@@ -0,0 +1,54 @@
+#include "validate.h"
+using namespace std;
+
+/**
+ * Checks a run of moves on one scratch board.
+ *
+ * @param checks The moves to check.
+ * @param count Number of moves.
+ * @param results Where to store each move's outcome.
+ * @param board Scratch board. Assigning a position to it reuses the memory it already has.
+ */
+static void validateRange(const MoveCheck *checks, size_t count, int *results, Board &board)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        board = *checks[i].position;
+        results[i] = board.try_move(checks[i].move).outcome;
+    }
+}
+
+/**
+ * Checks a batch of moves against the rules, storing each one's movement outcome code.
+ *
+ * Small batches are checked on the calling thread. Large ones are cut into chunks, which the workers claim one at
+ * a time. Every result goes in its own slot, so the workers never need to coordinate beyond claiming chunks.
+ *
+ * @param checks The moves to check, and the positions they're played in.
+ * @param count Number of moves.
+ * @param results Where to store each move's outcome: BAD, GOOD, CHECK, CHECKMATE, or STALEMATE.
+ */
+void MoveValidator::validate(const MoveCheck *checks, size_t count, int *results)
+{
+    if (count < VALIDATE_PARALLEL_MIN || _pool.size() <= 1)
+    {
+        validateRange(checks, count, results, _boards.back());
+        return;
+    }
+
+    // The job only captures a single pointer, so handing it to the pool doesn't allocate.
+    struct Batch
+    {
+        const MoveCheck *checks;
+        size_t count;
+        int *results;
+        vector<Board> *boards;
+    } batch = {checks, count, results, &_boards};
+
+    const Batch *job = &batch;
+    _pool.run((count + VALIDATE_CHUNK - 1) / VALIDATE_CHUNK, [job](size_t item, int worker) {
+        size_t start = item * VALIDATE_CHUNK;
+        size_t length = min(VALIDATE_CHUNK, job->count - start);
+        validateRange(job->checks + start, length, job->results + start, (*job->boards)[worker]);
+    });
+}
@@ -0,0 +1,45 @@
+#ifndef VALIDATE_H
+#define VALIDATE_H
+
+#include "board.h"
+#include "threadpool.h"
+#include <vector>
+using namespace std;
+
+// Batches smaller than this are checked on the calling thread, since waking the workers would cost more than it saves.
+const size_t VALIDATE_PARALLEL_MIN = 256;
+
+// Number of items a worker claims at a time from a large batch.
+const size_t VALIDATE_CHUNK = 64;
+
+// A move to check, and the position it's played in. The position's turn says who is moving.
+struct MoveCheck
+{
+    const Board *position; // Position the move is played in. It isn't changed.
+    Move move;             // The move to check.
+};
+
+// Checks whole batches of moves against the rules at once, for backends that take moves from lots of clients.
+//
+// Nothing is printed or read. Every move is tried on a scratch board that's overwritten with the next position, and
+// every worker has scratch boards of its own, so the validator itself allocates nothing per move. The rules it checks
+// moves against still do: Board::try_move() goes through the pieces' moveCheck() and allMoveCheck() and through
+// Board::is_suicide(), which all build vectors, so each move costs a few hundred heap allocations. make microbench
+// reports the exact number. Large batches are split across a pool of threads.
+class MoveValidator
+{
+private:
+    // Attributes.
+    ThreadPool _pool;      // Workers for large batches.
+    vector<Board> _boards; // Scratch board for each worker, and one more for the calling thread.
+
+public:
+    // Constructor.
+    explicit MoveValidator(int threads = 0) : _pool(threads), _boards(_pool.size() + 1) {} // Start the given number of workers, or one per core if 0.
+
+    // Check count moves, and store each one's movement outcome code from piece.h in results: BAD if the move is
+    // illegal, otherwise GOOD, CHECK, CHECKMATE, or STALEMATE. results must have room for count codes.
+    void validate(const MoveCheck *checks, size_t count, int *results);
+};
+
+#endif // VALIDATE_H